@@ -1,9 +1,28 @@
+#define _FILE_OFFSET_BITS 64  // 64-bit off_t for fseeko on 32-bit hosts
+
 #include "raylib.h"
+#include "rlgl.h"
+#include "net.h"
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#define popen  _popen
+#define pclose _pclose
+#define fseeko _fseeki64        // long is 32-bit here; the index outgrows it
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
 
 // ==========================================
 //          GLOBAL CONFIGURATION
@@ -24,6 +43,182 @@
 #define MAX_LEVELS    2
 #define MAX_PLAYERS   10
 
+// ENTITY SETTINGS
+#define MAX_ENTITIES  1024
+#define MAX_GHOSTS    256
+#define MAX_PELLETS   256
+#define GHOST_RADIUS  16.0f
+#define GHOST_DRIFT   1.0f    // Extra leftward speed on top of the level scroll
+#define GHOST_ACCEL   0.15f
+#define GHOST_MAX_VY  2.5f
+#define PELLET_RADIUS 8.0f
+#define POWER_TICKS   (FPS * 3) // Invulnerability after eating a power pellet
+#define SLOT_SPACING  300       // Distance between pipes; ghosts/pellets sit halfway
+
+// THREADING SETTINGS
+#define INPUT_QUEUE_SIZE 64        // Power of two
+#define MAX_TICK_KEYS    8
+#define MAX_TICK_CHARS   16
+#define SIM_RESYNC_SECS  0.25      // Drop the backlog after a stall this long
+
+// RENDER SETTINGS
+#define SCALE_DOWN_FRAMES  6     // Consecutive slow frames before dropping resolution
+#define SCALE_UP_FRAMES    120   // Consecutive fast frames before raising it again
+#define SCALE_SLOW_BUDGET  0.90f // Fraction of the frame budget counted as slow
+#define SCALE_FAST_BUDGET  0.55f
+#define PACER_MIN_SPIN     0.0005
+#define PACER_MAX_SPIN     0.004
+
+// GEOMETRY CACHE SETTINGS
+#define MOUTH_FRAMES      16     // Power of two; keyframes over one chomp
+#define MOUTH_PHASE_STEP  1738   // 10 rad/s at 60 ticks, in 1/65536 turns
+#define TILT_MIN          -25
+#define TILT_STEP         5
+#define TILT_BUCKETS      13     // -25..35 degrees
+#define PELLET_FRAMES     8
+#define ATLAS_WIDTH       1024
+#define ATLAS_HEIGHT      576
+#define ATLAS_PAD         2      // Transparent border so bilinear never bleeds
+#define PACMAN_CELL       ((int)PACMAN_RADIUS * 2 + ATLAS_PAD * 2)
+#define GHOST_CELL        ((int)GHOST_RADIUS * 2 + ATLAS_PAD * 2)
+#define PELLET_CELL       ((int)PELLET_RADIUS * 2 + ATLAS_PAD * 2)
+#define ORB_CELL          (5 * 2 + ATLAS_PAD * 2)
+
+// REPLAY SETTINGS
+#define REPLAY_VERSION    2
+#define REPLAY_TAIL_TICKS (FPS * 2)  // Victory screen kept on after a replay ends
+#define MAX_RENDER_JOBS   64
+
+// BROADCAST SETTINGS
+#define BROADCAST_PORT      7777
+#define KEYFRAME_TICKS      FPS      // Late joiners wait at most this long
+#define MAX_SPECTATORS      1024
+#define SPECTATOR_BACKLOG   64       // Packets queued per viewer before a resync
+#define PACKET_QUEUE_SIZE   128      // Power of two
+#define WIRE_SCALE          8.0f     // Positions travel in 1/8 pixel units
+#define WIRE_ANGLE_SCALE    64.0f
+#define WIRE_MAX_BYTES      (64 * 1024)
+
+// PLAYER INDEX SETTINGS
+#define INDEX_PATH       "players.idx"
+#define INDEX_VERSION    1
+#define INDEX_BUCKETS    (1 << 20) // ~10 names per chain at 10M players
+#define INDEX_CACHE_SIZE 4096      // Power of two
+#define NEIGHBOR_SPAN    2         // Players shown above and below you
+
+// SIMULATION MODE
+// Build with -DFIXED_POINT_PHYSICS to run all positions, velocities and
+// collision tests in Q16.16 integers. Float builds can differ between -g and
+// -O2 or between compilers; the fixed-point build is bit-identical everywhere.
+
+// ==========================================
+//          NUMERICS
+// ==========================================
+
+#ifdef FIXED_POINT_PHYSICS
+
+typedef int32_t Real;
+
+#define REAL_SHIFT 16
+#define REAL_ONE   (1 << REAL_SHIFT)
+
+// Only for compile-time constants; rounding happens in the compiler
+#define REAL(x)           ((Real)((x) * (double)REAL_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+#define RealFromInt(i)    ((Real)((i) * REAL_ONE))
+#define RealToInt(r)      ((int)((r) >> REAL_SHIFT))
+#define RealToFloat(r)    ((float)(r) / (float)REAL_ONE)
+#define RealMul(a, b)     ((Real)(((int64_t)(a) * (int64_t)(b)) >> REAL_SHIFT))
+
+// One full turn sampled at 256 points, Q16.16, plus the wrap-around entry
+const int32_t sineTable[257] = {
+         0,   1608,   3216,   4821,   6424,   8022,   9616,  11204,
+     12785,  14359,  15924,  17479,  19024,  20557,  22078,  23586,
+     25080,  26558,  28020,  29466,  30893,  32303,  33692,  35062,
+     36410,  37736,  39040,  40320,  41576,  42806,  44011,  45190,
+     46341,  47464,  48559,  49624,  50660,  51665,  52639,  53581,
+     54491,  55368,  56212,  57022,  57798,  58538,  59244,  59914,
+     60547,  61145,  61705,  62228,  62714,  63162,  63572,  63944,
+     64277,  64571,  64827,  65043,  65220,  65358,  65457,  65516,
+     65536,  65516,  65457,  65358,  65220,  65043,  64827,  64571,
+     64277,  63944,  63572,  63162,  62714,  62228,  61705,  61145,
+     60547,  59914,  59244,  58538,  57798,  57022,  56212,  55368,
+     54491,  53581,  52639,  51665,  50660,  49624,  48559,  47464,
+     46341,  45190,  44011,  42806,  41576,  40320,  39040,  37736,
+     36410,  35062,  33692,  32303,  30893,  29466,  28020,  26558,
+     25080,  23586,  22078,  20557,  19024,  17479,  15924,  14359,
+     12785,  11204,   9616,   8022,   6424,   4821,   3216,   1608,
+         0,  -1608,  -3216,  -4821,  -6424,  -8022,  -9616, -11204,
+    -12785, -14359, -15924, -17479, -19024, -20557, -22078, -23586,
+    -25080, -26558, -28020, -29466, -30893, -32303, -33692, -35062,
+    -36410, -37736, -39040, -40320, -41576, -42806, -44011, -45190,
+    -46341, -47464, -48559, -49624, -50660, -51665, -52639, -53581,
+    -54491, -55368, -56212, -57022, -57798, -58538, -59244, -59914,
+    -60547, -61145, -61705, -62228, -62714, -63162, -63572, -63944,
+    -64277, -64571, -64827, -65043, -65220, -65358, -65457, -65516,
+    -65536, -65516, -65457, -65358, -65220, -65043, -64827, -64571,
+    -64277, -63944, -63572, -63162, -62714, -62228, -61705, -61145,
+    -60547, -59914, -59244, -58538, -57798, -57022, -56212, -55368,
+    -54491, -53581, -52639, -51665, -50660, -49624, -48559, -47464,
+    -46341, -45190, -44011, -42806, -41576, -40320, -39040, -37736,
+    -36410, -35062, -33692, -32303, -30893, -29466, -28020, -26558,
+    -25080, -23586, -22078, -20557, -19024, -17479, -15924, -14359,
+    -12785, -11204,  -9616,  -8022,  -6424,  -4821,  -3216,  -1608,
+         0
+};
+
+// Radians in, Q16.16 sine out. The angle is folded into a 16-bit turn
+// fraction, then linearly interpolated between table entries.
+Real RealSin(Real radians) {
+    uint32_t turn = (uint32_t)RealMul(radians, REAL(0.15915494309189535)) & 0xFFFF;
+    int index = turn >> 8;
+    int32_t frac = turn & 0xFF;
+    int32_t a = sineTable[index];
+    int32_t b = sineTable[index + 1];
+    return a + (((b - a) * frac) >> 8);
+}
+
+#else
+
+typedef float Real;
+
+#define REAL(x)           ((float)(x))
+#define RealFromInt(i)    ((float)(i))
+#define RealToInt(r)      ((int)(r))
+#define RealToFloat(r)    (r)
+#define RealMul(a, b)     ((a) * (b))
+#define RealSin(r)        sinf(r)
+
+#endif
+
+// Axis-aligned box in simulation units. Same test as CheckCollisionRecs,
+// but stays in integer compares when Real is fixed-point.
+typedef struct {
+    Real x, y, width, height;
+} Box;
+
+bool BoxesOverlap(Box a, Box b) {
+    return a.x < b.x + b.width && a.x + a.width > b.x &&
+           a.y < b.y + b.height && a.y + a.height > b.y;
+}
+
+// Level layout randomness (xorshift32). rand() gives different sequences
+// under MSVCRT and glibc, and a replay must rebuild the same level on both.
+uint32_t runRandomState = 1;
+
+void SeedRunRandom(uint32_t seed) {
+    runRandomState = seed ? seed : 0x9E3779B9u; // Zero would stick at zero
+}
+
+// Uniform enough in [0, n) for layout; n must be positive
+int RunRandom(int n) {
+    uint32_t x = runRandomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    runRandomState = x;
+    return (int)(x % (uint32_t)n);
+}
+
 // ==========================================
 //          DATA STRUCTURES
 // ==========================================
@@ -40,9 +235,11 @@ typedef enum {
 
 typedef struct {
     int pipeCount;
-    float speed;
-    float gapSize;
-    float gravity;
+    int ghostCount;
+    int pelletCount;
+    Real speed;
+    Real gapSize;
+    Real gravity;
     Color color;
 } LevelData;
 
@@ -52,10 +249,220 @@ typedef struct {
     bool active;
 } PlayerData;
 
+// Rolling timings for one thread's loop
+typedef struct {
+    float lastMs;
+    float avgMs;
+    float peakMs;       // Worst iteration in the last full second
+    float rateHz;       // Iterations completed in the last full second
+    int overruns;       // Iterations that blew their budget, ever
+    double windowStart;
+    int windowCount;
+    float windowPeak;
+} LoopStats;
+
+// Everything DrawGame() reads, captured by the simulation at the end of a
+// tick. The render thread only ever sees complete, immutable copies.
+typedef struct {
+    unsigned int frame;
+    unsigned int runFrame;  // Same clock live, offline and on spectators
+    GameState state;
+    int level;
+    int score;
+    char name[16];
+
+    float pacmanY;
+    float pacmanVelocityY;
+    float mouthAngle;
+    int mouthFrame;
+    int powerTicks;
+
+    int pipeCount;
+    float pipeX[MAX_PIPES];
+    float pipeGapY[MAX_PIPES];
+    float orbRelY[MAX_PIPES];
+    bool orbCollected[MAX_PIPES];
+
+    int ghostCount;
+    float ghostX[MAX_GHOSTS];
+    float ghostY[MAX_GHOSTS];
+    Color ghostColor[MAX_GHOSTS];
+
+    int pelletCount;
+    float pelletX[MAX_PELLETS];
+    float pelletY[MAX_PELLETS];
+
+    // Victory screen
+    int playerCount;
+    PlayerData players[MAX_PLAYERS];
+    int playerRank;
+    int playerBest;
+    int rankedPlayerCount;
+    int neighborCount;
+    PlayerData neighbors[NEIGHBOR_SPAN * 2 + 1];
+    int neighborRanks[NEIGHBOR_SPAN * 2 + 1];
+
+    LoopStats simStats;
+} FrameSnapshot;
+
+// Key presses and typed characters handed to one simulation tick
+typedef struct {
+    int keys[MAX_TICK_KEYS];
+    int keyCount;
+    int chars[MAX_TICK_CHARS];
+    int charCount;
+    int charRead;
+} TickInput;
+
+typedef struct {
+    int key;            // Raylib key code, 0 for a typed character
+    int character;
+} InputEvent;
+
+// Replay file: header, every input event of one run in tick order, then the
+// victory board. Together with the seed and name this reproduces the run
+// exactly on the same build; realSize stops float replays loading into
+// fixed-point builds.
+typedef struct {
+    char magic[4];
+    int32_t version;
+    int32_t realSize;
+    uint32_t seed;
+    char name[16];
+    uint32_t tickCount;
+    uint32_t eventCount;
+} ReplayHeader;
+
+typedef struct {
+    uint32_t tick;
+    int32_t key;
+    int32_t character;
+} ReplayEvent;
+
+// Victory screen as it was shown; the index has moved on by render time
+typedef struct {
+    int32_t playerCount;
+    int32_t playerRank;
+    int32_t playerBest;
+    int32_t rankedPlayerCount;
+    int32_t neighborCount;
+    PlayerData players[MAX_PLAYERS];
+    PlayerData neighbors[NEIGHBOR_SPAN * 2 + 1];
+    int32_t neighborRanks[NEIGHBOR_SPAN * 2 + 1];
+} ReplayBoard;
+
+// Broadcast state: the snapshot flattened into quantized int32 sections.
+// Each tick is sent as per-value deltas against the previous tick, and a
+// section that didn't change at all costs one byte.
+typedef enum {
+    WIRE_CORE,          // State, score, Pacman, name
+    WIRE_PIPES,         // Count, then x/gapY/orbY per pipe, then orb bits
+    WIRE_GHOSTS,
+    WIRE_PELLETS,
+    WIRE_BOARD,         // Victory screen
+    WIRE_SECTION_COUNT
+} WireSectionId;
+
+#define WIRE_SECTION_MAX (1 + 3 * MAX_GHOSTS)
+
+typedef struct {
+    int32_t length;
+    int32_t values[WIRE_SECTION_MAX];
+} WireSection;
+
+typedef struct {
+    WireSection sections[WIRE_SECTION_COUNT];
+} WireState;
+
+typedef enum {
+    PACKET_KEYFRAME = 1,
+    PACKET_DELTA    = 2
+} PacketType;
+
+// One encoded tick, shared by every spectator queue that holds it. Only
+// the broadcast thread touches 'refs'.
+typedef struct {
+    int refs;
+    bool keyframe;
+    uint32_t frame;
+    int length;
+    uint8_t bytes[];
+} Packet;
+
+typedef struct {
+    NetSocket socket;
+    bool waitingForKeyframe;
+    Packet *queue[SPECTATOR_BACKLOG];
+    int queueHead;
+    int queueCount;
+    int sentBytes;      // Progress into queue[queueHead]
+} Spectator;
+
+// ------------------------------------------
+//  Entity Store
+// ------------------------------------------
+// Each archetype owns a dense table of contiguous component columns, so the
+// systems further down walk them linearly. Rows are swap-removed to stay
+// packed; outside code refers to entities through generational handles.
+
+typedef enum {
+    ARCH_PIPE,          // Pipe pair plus its orb
+    ARCH_GHOST,         // Chases Pacman across the gap
+    ARCH_PELLET,        // Power pellet
+    ARCH_COUNT
+} Archetype;
+
+typedef struct {
+    int index;
+    unsigned int generation;
+} EntityHandle;
+
+typedef struct {
+    unsigned int generation;
+    int archetype;      // -1 when the slot is free
+    int row;
+} EntitySlot;
+
+typedef struct {
+    int count;
+    int owner[MAX_PIPES];
+    Real x[MAX_PIPES];
+    Real gapY[MAX_PIPES];
+    Real baseGapY[MAX_PIPES];
+    Real phase[MAX_PIPES];
+    bool passed[MAX_PIPES];
+    bool orbCollected[MAX_PIPES];
+    Real orbRelY[MAX_PIPES];
+} PipeTable;
+
+typedef struct {
+    int count;
+    int owner[MAX_GHOSTS];
+    Real x[MAX_GHOSTS];
+    Real y[MAX_GHOSTS];
+    Real velY[MAX_GHOSTS];
+    Color color[MAX_GHOSTS];
+} GhostTable;
+
+typedef struct {
+    int count;
+    int owner[MAX_PELLETS];
+    Real x[MAX_PELLETS];
+    Real y[MAX_PELLETS];
+} PelletTable;
+
 LevelData levels[MAX_LEVELS];
 PlayerData players[MAX_PLAYERS];
 int playerCount = 0;
 
+// Victory screen stats, filled from the player index once per win
+int playerRank = 0;
+int playerBest = 0;
+int rankedPlayerCount = 0;
+PlayerData neighbors[NEIGHBOR_SPAN * 2 + 1];
+int neighborRanks[NEIGHBOR_SPAN * 2 + 1];
+int neighborCount = 0;
+
 // ==========================================
 //          GAME VARIABLES
 // ==========================================
@@ -70,346 +477,2636 @@ int currentSessionScore = 0;
 int levelStartScore = 0;
 
 // Entities
-float pacmanY;
-float pacmanVelocityY;
+Real pacmanY;
+Real pacmanVelocityY;
 float currentMouthAngle = 45.0f;
-float animationTime = 0.0f;
+uint16_t mouthPhase = 0;    // Wraps once per chomp
+
+// 25 + 20 * sin(2 * PI * i / MOUTH_FRAMES), so the update loop never calls sinf
+const float mouthAngles[MOUTH_FRAMES] = {
+    25.0000f, 32.6537f, 39.1421f, 43.4776f, 45.0000f, 43.4776f, 39.1421f, 32.6537f,
+    25.0000f, 17.3463f, 10.8579f,  6.5224f,  5.0000f,  6.5224f, 10.8579f, 17.3463f
+};
+
+int MouthFrame() {
+    return mouthPhase / (65536 / MOUTH_FRAMES);
+}
 
-// Pipe Arrays
-float pipeX[MAX_PIPES];
-float pipeGapY[MAX_PIPES];
-float initialPipeGapY[MAX_PIPES];
-bool pipePassed[MAX_PIPES];
-bool orbCollected[MAX_PIPES];
-float orbRelY[MAX_PIPES];
+int powerTicks = 0;
+int simTick = 0;        // Ticks since the level started; drives pipe motion
+
+// Entity Tables
+EntitySlot entitySlots[MAX_ENTITIES];
+int freeSlots[MAX_ENTITIES];
+int freeSlotCount = 0;
+
+PipeTable pipes;
+GhostTable ghosts;
+PelletTable pellets;
+
+// ------------------------------------------
+//  Thread Handoff
+// ------------------------------------------
+
+// Triple buffer: the simulation fills snapshots[simWriteIndex], then swaps it
+// into the shared middle slot. The renderer swaps the middle slot with its
+// own only when SNAPSHOT_FRESH is set, so neither side ever waits.
+#define SNAPSHOT_FRESH 4
+FrameSnapshot snapshots[3];
+atomic_int snapshotMiddle = 1;
+int simWriteIndex = 0;
+int renderReadIndex = 2;
+
+// Single-producer (render) / single-consumer (simulation) input ring
+InputEvent inputQueue[INPUT_QUEUE_SIZE];
+atomic_uint inputHead = 0;
+atomic_uint inputTail = 0;
+
+TickInput tickInput;
+atomic_bool simRunning = true;
+unsigned int simFrame = 0;
+unsigned int runTick = 0;   // Ticks since StartRun(); animation runs off this
+LoopStats simStats;
+LoopStats renderStats;
+bool showStats = false;
+
+// Replays (the events buffer is shared by recording and playback)
+ReplayHeader replayHeader;
+ReplayBoard replayBoard;
+ReplayEvent *replayEvents = NULL;
+uint32_t replayEventCapacity = 0;
+uint32_t replayCursor = 0;
+int32_t replayTick = 0;
+bool replayRecording = false;
+bool replayPlayback = false;
+
+// Destruction is deferred so systems never swap rows mid-iteration
+EntityHandle destroyQueue[MAX_ENTITIES];
+int destroyQueueCount = 0;
 
 // ==========================================
-//          SETUP FUNCTIONS
+//          ENTITY STORE
 // ==========================================
 
-void SetupLevels() {
-    // ---------------- LEVEL 1 ----------------
-    levels[0].pipeCount = 5;
-    levels[0].speed     = 3.0f;
-    levels[0].gapSize   = 160.0f;
-    levels[0].gravity   = 0.4f;
-    levels[0].color     = SKYBLUE;
+void ClearEntities() {
+    // Live slots are freed like a destroy would, so stale handles stay invalid
+    freeSlotCount = 0;
+    for (int i = MAX_ENTITIES - 1; i >= 0; i--) {
+        if (entitySlots[i].archetype >= 0) entitySlots[i].generation++;
+        entitySlots[i].archetype = -1;
+        freeSlots[freeSlotCount++] = i;
+    }
 
-    // ---------------- LEVEL 2 (Moving Pipes) ----------------
-    levels[1].pipeCount = 10;
-    levels[1].speed     = 3.5f;
-    levels[1].gapSize   = 150.0f;
-    levels[1].gravity   = 0.45f;
-    levels[1].color     = LIME;
+    pipes.count = 0;
+    ghosts.count = 0;
+    pellets.count = 0;
+    destroyQueueCount = 0;
 }
 
-void ResetEntityPositions() {
-    LevelData cur = levels[currentLevel];
-
-    pacmanY = SCREEN_HEIGHT / 2.0f;
-    pacmanVelocityY = 0;
-    animationTime = 0;
+int *ArchetypeOwners(Archetype arch) {
+    switch (arch) {
+        case ARCH_PIPE:   return pipes.owner;
+        case ARCH_GHOST:  return ghosts.owner;
+        case ARCH_PELLET: return pellets.owner;
+        default:          return NULL;
+    }
+}
 
-    // Generate Pipes
-    for (int i = 0; i < cur.pipeCount; i++) {
-        pipeX[i] = SCREEN_WIDTH + 300 + (i * 300);
+int *ArchetypeCount(Archetype arch) {
+    switch (arch) {
+        case ARCH_PIPE:   return &pipes.count;
+        case ARCH_GHOST:  return &ghosts.count;
+        case ARCH_PELLET: return &pellets.count;
+        default:          return NULL;
+    }
+}
 
-        int minGap = 50;
-        int maxGap = SCREEN_HEIGHT - 50 - (int)cur.gapSize;
-        if (maxGap < minGap) maxGap = minGap + 10;
+int ArchetypeCapacity(Archetype arch) {
+    switch (arch) {
+        case ARCH_PIPE:   return MAX_PIPES;
+        case ARCH_GHOST:  return MAX_GHOSTS;
+        case ARCH_PELLET: return MAX_PELLETS;
+        default:          return 0;
+    }
+}
 
-        float randomY = minGap + rand() % (maxGap - minGap);
+// Copies every column of row 'src' over row 'dst' in the given table
+void MoveRow(Archetype arch, int dst, int src) {
+    switch (arch) {
+        case ARCH_PIPE:
+            pipes.owner[dst]        = pipes.owner[src];
+            pipes.x[dst]            = pipes.x[src];
+            pipes.gapY[dst]         = pipes.gapY[src];
+            pipes.baseGapY[dst]     = pipes.baseGapY[src];
+            pipes.phase[dst]        = pipes.phase[src];
+            pipes.passed[dst]       = pipes.passed[src];
+            pipes.orbCollected[dst] = pipes.orbCollected[src];
+            pipes.orbRelY[dst]      = pipes.orbRelY[src];
+            break;
+        case ARCH_GHOST:
+            ghosts.owner[dst] = ghosts.owner[src];
+            ghosts.x[dst]     = ghosts.x[src];
+            ghosts.y[dst]     = ghosts.y[src];
+            ghosts.velY[dst]  = ghosts.velY[src];
+            ghosts.color[dst] = ghosts.color[src];
+            break;
+        case ARCH_PELLET:
+            pellets.owner[dst] = pellets.owner[src];
+            pellets.x[dst]     = pellets.x[src];
+            pellets.y[dst]     = pellets.y[src];
+            break;
+        default:
+            break;
+    }
+}
 
-        pipeGapY[i] = randomY;
-        initialPipeGapY[i] = randomY;
+// Returns the new entity's row in its archetype table, or -1 when full
+int CreateEntity(Archetype arch, EntityHandle *outHandle) {
+    int *count = ArchetypeCount(arch);
+    if (freeSlotCount == 0 || *count >= ArchetypeCapacity(arch)) return -1;
 
-        // Orb Logic
-        orbCollected[i] = false;
-        int padding = 20;
-        int safeRange = (int)cur.gapSize - (padding * 2);
+    int slot = freeSlots[--freeSlotCount];
+    int row = (*count)++;
 
-        if (safeRange > 0) {
-            orbRelY[i] = padding + (rand() % safeRange);
-        } else {
-            orbRelY[i] = cur.gapSize / 2;
-        }
+    entitySlots[slot].archetype = arch;
+    entitySlots[slot].row = row;
+    ArchetypeOwners(arch)[row] = slot;
 
-        pipePassed[i] = false;
+    if (outHandle) {
+        outHandle->index = slot;
+        outHandle->generation = entitySlots[slot].generation;
     }
+    return row;
 }
 
-// ==========================================
-//          UPDATE LOGIC
-// ==========================================
+bool EntityIsAlive(EntityHandle h) {
+    if (h.index < 0 || h.index >= MAX_ENTITIES) return false;
+    return entitySlots[h.index].archetype >= 0 && entitySlots[h.index].generation == h.generation;
+}
 
-void UpdateInput() {
-    int key = GetCharPressed();
+EntityHandle HandleForRow(Archetype arch, int row) {
+    int slot = ArchetypeOwners(arch)[row];
+    EntityHandle h = { slot, entitySlots[slot].generation };
+    return h;
+}
 
-    while (key > 0) {
-        if ((key >= 32) && (key <= 125) && (letterCount < 15)) {
-            tempName[letterCount] = (char)key;
-            tempName[letterCount+1] = '\0';
-            letterCount++;
-        }
-        key = GetCharPressed();
-    }
+void DestroyEntity(EntityHandle h) {
+    if (!EntityIsAlive(h)) return;
 
-    if (IsKeyPressed(KEY_BACKSPACE)) {
-        letterCount--;
-        if (letterCount < 0) letterCount = 0;
-        tempName[letterCount] = '\0';
-    }
+    EntitySlot *slot = &entitySlots[h.index];
+    Archetype arch = (Archetype)slot->archetype;
+    int *count = ArchetypeCount(arch);
+    int last = --(*count);
 
-    if (IsKeyPressed(KEY_ENTER) && letterCount > 0) {
-        currentState = STATE_TITLE;
-        currentSessionScore = 0;
-        levelStartScore = 0;
-        currentLevel = 0;
-        ResetEntityPositions();
+    // Swap-remove: move the last row into the hole and repoint its slot
+    if (slot->row != last) {
+        MoveRow(arch, slot->row, last);
+        entitySlots[ArchetypeOwners(arch)[slot->row]].row = slot->row;
     }
+
+    slot->archetype = -1;
+    slot->generation++;
+    freeSlots[freeSlotCount++] = h.index;
 }
 
-void UpdateGame() {
-    if (currentState == STATE_INPUT) {
-        UpdateInput();
-        return;
+void QueueDestroy(Archetype arch, int row) {
+    if (destroyQueueCount < MAX_ENTITIES) {
+        destroyQueue[destroyQueueCount++] = HandleForRow(arch, row);
     }
+}
 
-    // State Transitions via Spacebar
-    if (IsKeyPressed(KEY_SPACE)) {
-        if (currentState == STATE_TITLE) {
-            currentState = STATE_PLAYING;
-            pacmanVelocityY = JUMP_STRENGTH;
-        }
-        else if (currentState == STATE_LEVEL_DONE) {
-            currentLevel++;
-            if (currentLevel >= MAX_LEVELS) {
-                // VICTORY LOGIC
-                currentState = STATE_VICTORY;
+void FlushDestroyQueue() {
+    // Handles make double-queued entities harmless
+    for (int i = 0; i < destroyQueueCount; i++) DestroyEntity(destroyQueue[i]);
+    destroyQueueCount = 0;
+}
 
-                // 1. Add Player to Scoreboard
-                if (playerCount < MAX_PLAYERS) {
-                    strcpy(players[playerCount].name, tempName);
-                    players[playerCount].score = currentSessionScore;
-                    players[playerCount].active = true;
-                    playerCount++;
-                }
+// ==========================================
+//          PLAYER INDEX
+// ==========================================
+// Persistent per-name personal bests. The file holds a header, a table of
+// hash buckets keyed on the 16-byte name, and fixed-size node records. The
+// same records form an order-statistic treap ordered by best score (ties go
+// to whoever registered first), with subtree sizes for O(log n) rank and select.
+// Nodes are read and written in place, so only touched records hit the disk.
 
-                // 2. SORT SCOREBOARD (Bubble Sort: Highest to Lowest)
-                for (int i = 0; i < playerCount - 1; i++) {
-                    for (int j = 0; j < playerCount - i - 1; j++) {
-                        if (players[j].score < players[j+1].score) {
-                            // Swap entire struct
-                            PlayerData temp = players[j];
-                            players[j] = players[j+1];
-                            players[j+1] = temp;
-                        }
-                    }
-                }
+typedef struct {
+    char magic[4];
+    int32_t version;
+    int32_t nodeCount;
+    int32_t root;
+} IndexHeader;
 
-            } else {
-                currentState = STATE_TITLE;
-                levelStartScore = currentSessionScore;
-                ResetEntityPositions();
-            }
-        }
-        else if (currentState == STATE_GAMEOVER) {
-            // Retry Level
-            currentSessionScore = levelStartScore;
-            currentState = STATE_TITLE;
-            ResetEntityPositions();
-        }
-        else if (currentState == STATE_VICTORY) {
-            // Return to input screen for new player
-            currentState = STATE_INPUT;
-            letterCount = 0;
-            tempName[0] = '\0';
-        }
+typedef struct {
+    char name[16];
+    int32_t best;
+    int32_t plays;
+    int32_t left;           // Treap children, 0 = none
+    int32_t right;
+    int32_t size;           // Nodes in this subtree
+    uint32_t priority;
+    int32_t nextInBucket;   // Name hash chain
+    int32_t pad;
+} IndexNode;
+
+FILE *indexFile = NULL;
+IndexHeader indexHeader;
+
+// Direct-mapped write-through cache; the top of the treap stays resident
+IndexNode indexCache[INDEX_CACHE_SIZE];
+int32_t indexCacheId[INDEX_CACHE_SIZE];
+
+int64_t IndexNodeOffset(int32_t id) {
+    return (int64_t)sizeof(IndexHeader) + (int64_t)INDEX_BUCKETS * sizeof(int32_t)
+         + (int64_t)(id - 1) * sizeof(IndexNode);
+}
+
+int64_t IndexBucketOffset(uint32_t bucket) {
+    return (int64_t)sizeof(IndexHeader) + (int64_t)bucket * sizeof(int32_t);
+}
+
+void LoadNode(int32_t id, IndexNode *out) {
+    int slot = id & (INDEX_CACHE_SIZE - 1);
+    if (indexCacheId[slot] == id) {
+        *out = indexCache[slot];
+        return;
     }
 
-    if (currentState != STATE_PLAYING) return;
+    fseeko(indexFile, IndexNodeOffset(id), SEEK_SET);
+    if (fread(out, sizeof(IndexNode), 1, indexFile) != 1) memset(out, 0, sizeof(IndexNode));
 
-    LevelData cur = levels[currentLevel];
+    indexCache[slot] = *out;
+    indexCacheId[slot] = id;
+}
 
-    // 1. Update Player
-    pacmanVelocityY += cur.gravity;
-    if (IsKeyPressed(KEY_SPACE)) pacmanVelocityY = JUMP_STRENGTH;
-    pacmanY += pacmanVelocityY;
+void StoreNode(int32_t id, const IndexNode *node) {
+    int slot = id & (INDEX_CACHE_SIZE - 1);
+    indexCache[slot] = *node;
+    indexCacheId[slot] = id;
 
-    // Animation
-    animationTime += GetFrameTime() * 10.0f;
-    currentMouthAngle = 25.0f + 20.0f * sinf(animationTime);
+    fseeko(indexFile, IndexNodeOffset(id), SEEK_SET);
+    fwrite(node, sizeof(IndexNode), 1, indexFile);
+}
 
-    // Bounds Collision
-    if (pacmanY - PACMAN_RADIUS <= 0 || pacmanY + PACMAN_RADIUS >= SCREEN_HEIGHT) {
-        currentState = STATE_GAMEOVER;
+int32_t LoadBucket(uint32_t bucket) {
+    int32_t head = 0;
+    fseeko(indexFile, IndexBucketOffset(bucket), SEEK_SET);
+    if (fread(&head, sizeof(head), 1, indexFile) != 1) head = 0;
+    return head;
+}
+
+void StoreBucket(uint32_t bucket, int32_t head) {
+    fseeko(indexFile, IndexBucketOffset(bucket), SEEK_SET);
+    fwrite(&head, sizeof(head), 1, indexFile);
+}
+
+void StoreHeader() {
+    fseek(indexFile, 0, SEEK_SET);
+    fwrite(&indexHeader, sizeof(indexHeader), 1, indexFile);
+}
+
+// FNV-1a over the zero-padded name
+uint32_t HashName(const char key[16]) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 16; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
     }
+    return h;
+}
 
-    // 2. Update Pipes
-    int pipesClearedCount = 0;
+// Deterministic priorities keep the tree shape reproducible from the file
+uint32_t NodePriority(int32_t id) {
+    uint32_t x = (uint32_t)id * 0x9E3779B9u;
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    return x;
+}
 
-    for (int i = 0; i < cur.pipeCount; i++) {
-        pipeX[i] -= cur.speed;
+int32_t SubtreeSize(int32_t id) {
+    if (id == 0) return 0;
+    IndexNode n;
+    LoadNode(id, &n);
+    return n.size;
+}
 
-        // Level 2 Sine Wave
-        if (currentLevel == 1) {
-            float time = GetTime();
-            pipeGapY[i] = initialPipeGapY[i] + sinf(time * 3.0f + i) * 50.0f;
-        }
+// True when (scoreA, idA) ranks above (scoreB, idB)
+bool RanksBefore(int32_t scoreA, int32_t idA, int32_t scoreB, int32_t idB) {
+    return scoreA > scoreB || (scoreA == scoreB && idA < idB);
+}
 
-        // Collision Rectangles
-        Rectangle topPipe = { pipeX[i], 0, PIPE_WIDTH, pipeGapY[i] };
-        Rectangle botPipe = { pipeX[i], pipeGapY[i] + cur.gapSize, PIPE_WIDTH, SCREEN_HEIGHT };
-        Rectangle player  = { PACMAN_X_POS - PACMAN_RADIUS + 5, pacmanY - PACMAN_RADIUS + 5, PACMAN_RADIUS*2 - 10, PACMAN_RADIUS*2 - 10 };
+// Splits 't' into nodes ranking before (score, id) and everything else
+void TreapSplit(int32_t t, int32_t score, int32_t id, int32_t *left, int32_t *right) {
+    if (t == 0) {
+        *left = *right = 0;
+        return;
+    }
 
-        if (CheckCollisionRecs(topPipe, player) || CheckCollisionRecs(botPipe, player)) {
-            currentState = STATE_GAMEOVER;
-        }
+    IndexNode n;
+    LoadNode(t, &n);
+    if (RanksBefore(n.best, t, score, id)) {
+        TreapSplit(n.right, score, id, &n.right, right);
+        *left = t;
+    } else {
+        TreapSplit(n.left, score, id, left, &n.left);
+        *right = t;
+    }
+    n.size = 1 + SubtreeSize(n.left) + SubtreeSize(n.right);
+    StoreNode(t, &n);
+}
 
-        // Orb Collection
-        if (!orbCollected[i]) {
-            Rectangle orbHitbox = {
-                pipeX[i] + (PIPE_WIDTH / 2) - 5,
-                pipeGapY[i] + orbRelY[i] - 5,
-                10, 10
-            };
-            if (CheckCollisionRecs(player, orbHitbox)) {
-                orbCollected[i] = true;
-                currentSessionScore += 5;
-            }
-        }
+int32_t TreapMerge(int32_t a, int32_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+
+    IndexNode na, nb;
+    LoadNode(a, &na);
+    LoadNode(b, &nb);
+    if (na.priority > nb.priority) {
+        na.right = TreapMerge(na.right, b);
+        na.size = 1 + SubtreeSize(na.left) + SubtreeSize(na.right);
+        StoreNode(a, &na);
+        return a;
+    }
+    nb.left = TreapMerge(a, nb.left);
+    nb.size = 1 + SubtreeSize(nb.left) + SubtreeSize(nb.right);
+    StoreNode(b, &nb);
+    return b;
+}
 
-        // Score Update (Passing Pipe)
-        if (!pipePassed[i] && pipeX[i] + PIPE_WIDTH < PACMAN_X_POS) {
-            pipePassed[i] = true;
-            currentSessionScore += 1;
-        }
+// 'item' must already have its best score and priority filled in
+int32_t TreapInsert(int32_t t, int32_t id, IndexNode *item) {
+    if (t == 0) {
+        item->left = item->right = 0;
+        item->size = 1;
+        StoreNode(id, item);
+        return id;
+    }
 
-        if (pipePassed[i]) pipesClearedCount++;
+    IndexNode n;
+    LoadNode(t, &n);
+    if (item->priority > n.priority) {
+        TreapSplit(t, item->best, id, &item->left, &item->right);
+        item->size = 1 + SubtreeSize(item->left) + SubtreeSize(item->right);
+        StoreNode(id, item);
+        return id;
     }
 
-    if (pipesClearedCount >= cur.pipeCount) {
-        currentState = STATE_LEVEL_DONE;
+    if (RanksBefore(item->best, id, n.best, t)) {
+        n.left = TreapInsert(n.left, id, item);
+    } else {
+        n.right = TreapInsert(n.right, id, item);
     }
+    n.size++;
+    StoreNode(t, &n);
+    return t;
 }
 
-// ==========================================
-//          DRAWING
-// ==========================================
+int32_t TreapErase(int32_t t, int32_t score, int32_t id) {
+    if (t == 0) return 0;
 
-void DrawGame() {
-    BeginDrawing();
-    ClearBackground(BLACK);
+    IndexNode n;
+    LoadNode(t, &n);
+    if (t == id) return TreapMerge(n.left, n.right);
 
-    LevelData cur = levels[currentLevel];
-    int border = 4; // Outline thickness
+    if (RanksBefore(score, id, n.best, t)) {
+        n.left = TreapErase(n.left, score, id);
+    } else {
+        n.right = TreapErase(n.right, score, id);
+    }
+    n.size--;
+    StoreNode(t, &n);
+    return t;
+}
 
-    if (currentState == STATE_INPUT) {
-        DrawText("WELCOME TO FLAPPY PACMAN", 160, 100, 30, YELLOW);
-        DrawText("Enter your name:", 300, 200, 20, WHITE);
+void PlayerIndexClose() {
+    if (indexFile) fclose(indexFile);
+    indexFile = NULL;
+}
 
-        // Draw Input Box
-        DrawRectangleLines(250, 230, 300, 40, WHITE);
-        DrawText(tempName, 260, 240, 20, YELLOW);
+bool PlayerIndexOpen(const char *path) {
+    for (int i = 0; i < INDEX_CACHE_SIZE; i++) indexCacheId[i] = 0;
 
-        // Blinking cursor
-        if ((int)(GetTime() * 2) % 2 == 0) {
-            DrawText("_", 260 + MeasureText(tempName, 20), 240, 20, YELLOW);
+    indexFile = fopen(path, "r+b");
+    if (indexFile) {
+        if (fread(&indexHeader, sizeof(indexHeader), 1, indexFile) == 1 &&
+            memcmp(indexHeader.magic, "PFIX", 4) == 0 && indexHeader.version == INDEX_VERSION) {
+            return true;
         }
+        // Unknown or damaged file: leave it alone and run without an index
+        PlayerIndexClose();
+        return false;
+    }
 
-        DrawText("Press ENTER to Start", 280, 300, 20, DARKGRAY);
+    // Fresh index: header plus an empty bucket table
+    indexFile = fopen(path, "w+b");
+    if (!indexFile) return false;
+
+    memcpy(indexHeader.magic, "PFIX", 4);
+    indexHeader.version = INDEX_VERSION;
+    indexHeader.nodeCount = 0;
+    indexHeader.root = 0;
+    StoreHeader();
+
+    int32_t zeros[1024] = { 0 };
+    for (int i = 0; i < INDEX_BUCKETS; i += 1024) {
+        fwrite(zeros, sizeof(zeros), 1, indexFile);
     }
-    else if (currentState == STATE_VICTORY) {
-        DrawText("YOU WIN!", 300, 50, 40, GOLD);
-        DrawText("SCOREBOARD (Top 10)", 280, 120, 20, WHITE);
-        DrawLine(280, 145, 520, 145, WHITE);
-
-        for (int i = 0; i < playerCount; i++) {
-            Color textColor = WHITE;
-            // Highlight the current player's new score
-            if (strcmp(players[i].name, tempName) == 0 && players[i].score == currentSessionScore) {
-                textColor = YELLOW;
-            }
+    fflush(indexFile);
+    return true;
+}
 
-            DrawText(TextFormat("%d. %s", i+1, players[i].name), 280, 160 + (i * 30), 20, textColor);
-            DrawText(TextFormat("%d", players[i].score), 480, 160 + (i * 30), 20, textColor);
-        }
+int32_t PlayerIndexFind(const char *name) {
+    char key[16] = { 0 };
+    strncpy(key, name, 15);
 
-        DrawText("Press SPACE to Play Again", 260, 420, 20, DARKGRAY);
+    int32_t id = LoadBucket(HashName(key) & (INDEX_BUCKETS - 1));
+    while (id != 0) {
+        IndexNode n;
+        LoadNode(id, &n);
+        if (memcmp(n.name, key, 16) == 0) return id;
+        id = n.nextInBucket;
     }
-    else {
-        // Draw Game Elements (Pipes, Orbs, Player)
+    return 0;
+}
 
-        // 1. Pipes
-        for (int i = 0; i < cur.pipeCount; i++) {
-            if (pipeX[i] > -PIPE_WIDTH && pipeX[i] < SCREEN_WIDTH) {
-                // Top Pipe
-                DrawRectangle(pipeX[i], 0, PIPE_WIDTH, pipeGapY[i], cur.color);
-                DrawRectangle(pipeX[i] + border, 0, PIPE_WIDTH - border*2, pipeGapY[i] - border, BLACK);
-
-                // Bottom Pipe
-                float bottomY = pipeGapY[i] + cur.gapSize;
-                float bottomHeight = SCREEN_HEIGHT - bottomY;
-                DrawRectangle(pipeX[i], bottomY, PIPE_WIDTH, bottomHeight, cur.color);
-                DrawRectangle(pipeX[i] + border, bottomY + border, PIPE_WIDTH - border*2, bottomHeight - border, BLACK);
-
-                // Orbs
-                if (!orbCollected[i]) {
-                     float finalOrbY = pipeGapY[i] + orbRelY[i];
-                     DrawCircle(pipeX[i] + (PIPE_WIDTH/2), finalOrbY, 5, WHITE);
-                }
-            }
+// Adds one finished run; returns the player's node id (0 if no index)
+int32_t PlayerIndexRecord(const char *name, int score) {
+    if (!indexFile) return 0;
+
+    int32_t id = PlayerIndexFind(name);
+    IndexNode n;
+
+    if (id == 0) {
+        memset(&n, 0, sizeof(n));
+        strncpy(n.name, name, 15);
+
+        uint32_t bucket = HashName(n.name) & (INDEX_BUCKETS - 1);
+        id = ++indexHeader.nodeCount;
+        n.nextInBucket = LoadBucket(bucket);
+        n.best = score;
+        n.plays = 1;
+        n.priority = NodePriority(id);
+
+        indexHeader.root = TreapInsert(indexHeader.root, id, &n);
+        StoreBucket(bucket, id);
+    } else {
+        LoadNode(id, &n);
+        n.plays++;
+
+        if (score > n.best) {
+            // Re-key: pull the node out, then insert it with its new best
+            indexHeader.root = TreapErase(indexHeader.root, n.best, id);
+            n.best = score;
+            indexHeader.root = TreapInsert(indexHeader.root, id, &n);
+        } else {
+            StoreNode(id, &n);
         }
+    }
 
-        // 2. Pacman
-        float tilt = pacmanVelocityY * 3.0f;
-        if (tilt > 35.0f) tilt = 35.0f;
-        if (tilt < -25.0f) tilt = -25.0f;
+    StoreHeader();
+    fflush(indexFile);
+    return id;
+}
 
-        DrawCircleSector((Vector2){PACMAN_X_POS, pacmanY}, PACMAN_RADIUS,
-                        currentMouthAngle + tilt, (360.0f - currentMouthAngle) + tilt, 0, YELLOW);
+// 1-based position among all indexed players, 0 if unknown
+int PlayerIndexRank(int32_t id) {
+    if (!indexFile || id == 0) return 0;
 
-        // 3. UI Overlays
-        DrawText(TextFormat("Score: %d", currentSessionScore), 10, 10, 20, WHITE);
-        DrawText(TextFormat("Level: %d", currentLevel + 1), 10, 35, 20, cur.color);
+    IndexNode target;
+    LoadNode(id, &target);
 
-        if (currentState == STATE_GAMEOVER) {
-            DrawText("GAME OVER", 280, 200, 40, RED);
-            DrawText("Press SPACE to Retry Level", 260, 250, 20, WHITE);
+    int rank = 0;
+    int32_t t = indexHeader.root;
+    while (t != 0) {
+        IndexNode n;
+        LoadNode(t, &n);
+        if (t == id) return rank + SubtreeSize(n.left) + 1;
+
+        if (RanksBefore(target.best, id, n.best, t)) {
+            t = n.left;
+        } else {
+            rank += SubtreeSize(n.left) + 1;
+            t = n.right;
         }
-        else if (currentState == STATE_LEVEL_DONE) {
-            DrawText("LEVEL COMPLETE!", 230, 200, 40, GREEN);
-            DrawText("Press SPACE for Next Level", 260, 250, 20, WHITE);
+    }
+    return 0;
+}
+
+// Fetches the player at a 1-based rank; false when out of range
+bool PlayerIndexSelect(int rank, PlayerData *out) {
+    if (!indexFile || rank < 1 || rank > indexHeader.nodeCount) return false;
+
+    int32_t t = indexHeader.root;
+    while (t != 0) {
+        IndexNode n;
+        LoadNode(t, &n);
+        int leftSize = SubtreeSize(n.left);
+
+        if (rank == leftSize + 1) {
+            memcpy(out->name, n.name, 16);
+            out->name[15] = '\0';
+            out->score = n.best;
+            out->active = true;
+            return true;
         }
-        else if (currentState == STATE_TITLE) {
-            DrawText(TextFormat("LEVEL %d", currentLevel + 1), 340, 180, 30, cur.color);
-            DrawText("Press SPACE to Fly", 300, 230, 20, WHITE);
+        if (rank <= leftSize) {
+            t = n.left;
+        } else {
+            rank -= leftSize + 1;
+            t = n.right;
         }
     }
-
-    EndDrawing();
+    return false;
 }
 
 // ==========================================
-//          MAIN
+//          THREADING
 // ==========================================
 
-int main(void) {
-    srand(time(NULL));
+double NowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Flappy Pacman - Scoreboard Edition");
-    SetTargetFPS(FPS);
+void SleepSeconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+void LoopStatsAdd(LoopStats *s, double now, float ms, float budgetMs) {
+    s->lastMs = ms;
+    s->avgMs = (s->avgMs == 0) ? ms : s->avgMs + (ms - s->avgMs) * 0.05f;
+    if (ms > budgetMs) s->overruns++;
+
+    if (ms > s->windowPeak) s->windowPeak = ms;
+    s->windowCount++;
+    if (now - s->windowStart >= 1.0) {
+        s->rateHz = s->windowCount / (float)(now - s->windowStart);
+        s->peakMs = s->windowPeak;
+        s->windowStart = now;
+        s->windowCount = 0;
+        s->windowPeak = 0;
+    }
+}
+
+// Render thread: queue an event for the next simulation tick. A full
+// queue drops the event rather than blocking the renderer.
+void PushInput(int key, int character) {
+    unsigned int head = atomic_load_explicit(&inputHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&inputTail, memory_order_acquire);
+    if (head - tail >= INPUT_QUEUE_SIZE) return;
+
+    inputQueue[head & (INPUT_QUEUE_SIZE - 1)] = (InputEvent){ key, character };
+    atomic_store_explicit(&inputHead, head + 1, memory_order_release);
+}
+
+// Render thread: raylib only polls input on the thread owning the window
+void CaptureInput() {
+    int key = GetCharPressed();
+    while (key > 0) {
+        PushInput(0, key);
+        key = GetCharPressed();
+    }
+
+    const int watched[] = { KEY_SPACE, KEY_ENTER, KEY_BACKSPACE };
+    for (int i = 0; i < 3; i++) {
+        if (IsKeyPressed(watched[i])) PushInput(watched[i], 0);
+    }
+}
+
+// Simulation thread: move everything queued so far into this tick
+void DrainInput() {
+    tickInput.keyCount = 0;
+    tickInput.charCount = 0;
+    tickInput.charRead = 0;
+
+    unsigned int tail = atomic_load_explicit(&inputTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&inputHead, memory_order_acquire);
+    while (tail != head) {
+        InputEvent e = inputQueue[tail & (INPUT_QUEUE_SIZE - 1)];
+        if (e.key != 0 && tickInput.keyCount < MAX_TICK_KEYS) {
+            tickInput.keys[tickInput.keyCount++] = e.key;
+        } else if (e.key == 0 && tickInput.charCount < MAX_TICK_CHARS) {
+            tickInput.chars[tickInput.charCount++] = e.character;
+        }
+        tail++;
+    }
+    atomic_store_explicit(&inputTail, tail, memory_order_release);
+}
+
+// Tick-side replacements for IsKeyPressed() / GetCharPressed()
+bool TickKeyPressed(int key) {
+    for (int i = 0; i < tickInput.keyCount; i++) {
+        if (tickInput.keys[i] == key) return true;
+    }
+    return false;
+}
+
+int TickCharPressed() {
+    if (tickInput.charRead >= tickInput.charCount) return 0;
+    return tickInput.chars[tickInput.charRead++];
+}
+
+void CaptureSnapshot(FrameSnapshot *s) {
+    s->frame = simFrame;
+    s->runFrame = runTick;
+    s->state = currentState;
+    s->level = currentLevel;
+    s->score = currentSessionScore;
+    memcpy(s->name, tempName, sizeof(s->name));
+
+    s->pacmanY = RealToFloat(pacmanY);
+    s->pacmanVelocityY = RealToFloat(pacmanVelocityY);
+    s->mouthAngle = currentMouthAngle;
+    s->mouthFrame = MouthFrame();
+    s->powerTicks = powerTicks;
+
+    s->pipeCount = pipes.count;
+    for (int i = 0; i < pipes.count; i++) {
+        s->pipeX[i] = RealToFloat(pipes.x[i]);
+        s->pipeGapY[i] = RealToFloat(pipes.gapY[i]);
+        s->orbRelY[i] = RealToFloat(pipes.orbRelY[i]);
+        s->orbCollected[i] = pipes.orbCollected[i];
+    }
+
+    s->ghostCount = ghosts.count;
+    for (int i = 0; i < ghosts.count; i++) {
+        s->ghostX[i] = RealToFloat(ghosts.x[i]);
+        s->ghostY[i] = RealToFloat(ghosts.y[i]);
+        s->ghostColor[i] = ghosts.color[i];
+    }
+
+    s->pelletCount = pellets.count;
+    for (int i = 0; i < pellets.count; i++) {
+        s->pelletX[i] = RealToFloat(pellets.x[i]);
+        s->pelletY[i] = RealToFloat(pellets.y[i]);
+    }
+
+    s->playerCount = playerCount;
+    memcpy(s->players, players, sizeof(players));
+    s->playerRank = playerRank;
+    s->playerBest = playerBest;
+    s->rankedPlayerCount = rankedPlayerCount;
+    s->neighborCount = neighborCount;
+    memcpy(s->neighbors, neighbors, sizeof(neighbors));
+    memcpy(s->neighborRanks, neighborRanks, sizeof(neighborRanks));
+
+    s->simStats = simStats;
+}
+
+// Returns the copy just handed over. The render thread only reads it and the
+// simulation can't get it back before its next publish, so it stays valid
+// for the rest of this tick.
+const FrameSnapshot *PublishSnapshot() {
+    FrameSnapshot *s = &snapshots[simWriteIndex];
+    CaptureSnapshot(s);
+    int previous = atomic_exchange_explicit(&snapshotMiddle, simWriteIndex | SNAPSHOT_FRESH, memory_order_acq_rel);
+    simWriteIndex = previous & 3;
+    return s;
+}
+
+// Returns the newest complete snapshot; repeats the last one if the
+// simulation hasn't published since
+const FrameSnapshot *AcquireSnapshot() {
+    if (atomic_load_explicit(&snapshotMiddle, memory_order_acquire) & SNAPSHOT_FRESH) {
+        int previous = atomic_exchange_explicit(&snapshotMiddle, renderReadIndex, memory_order_acq_rel);
+        renderReadIndex = previous & 3;
+    }
+    return &snapshots[renderReadIndex];
+}
+
+// ==========================================
+//          REPLAYS
+// ==========================================
+
+void ReplayAppend(uint32_t tick, int key, int character) {
+    if (replayHeader.eventCount == replayEventCapacity) {
+        uint32_t capacity = replayEventCapacity ? replayEventCapacity * 2 : 256;
+        ReplayEvent *grown = realloc(replayEvents, capacity * sizeof(ReplayEvent));
+        if (!grown) return;
+        replayEvents = grown;
+        replayEventCapacity = capacity;
+    }
+    replayEvents[replayHeader.eventCount++] = (ReplayEvent){ tick, key, character };
+}
+
+// Called from StartRun(); the tick that started the run isn't recorded.
+// Playback keeps the header and events ReplayLoad() filled in.
+void ReplayBegin(uint32_t seed) {
+    replayTick = -1;
+    replayCursor = 0;
+    replayRecording = !replayPlayback;
+    if (replayPlayback) return;
+
+    memcpy(replayHeader.magic, "PFRP", 4);
+    replayHeader.version = REPLAY_VERSION;
+    replayHeader.realSize = sizeof(Real);
+    replayHeader.seed = seed;
+    memcpy(replayHeader.name, tempName, sizeof(replayHeader.name));
+    replayHeader.tickCount = 0;
+    replayHeader.eventCount = 0;
+}
+
+bool ReplaySave(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(&replayHeader, sizeof(replayHeader), 1, f) == 1 &&
+              fwrite(replayEvents, sizeof(ReplayEvent), replayHeader.eventCount, f) == replayHeader.eventCount &&
+              fwrite(&replayBoard, sizeof(replayBoard), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+bool ReplayLoad(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    bool ok = fread(&replayHeader, sizeof(replayHeader), 1, f) == 1 &&
+              memcmp(replayHeader.magic, "PFRP", 4) == 0 &&
+              replayHeader.version == REPLAY_VERSION &&
+              replayHeader.realSize == (int32_t)sizeof(Real);
+
+    if (ok) {
+        free(replayEvents);
+        replayEventCapacity = replayHeader.eventCount;
+        replayEvents = malloc((replayEventCapacity ? replayEventCapacity : 1) * sizeof(ReplayEvent));
+        ok = replayEvents && fread(replayEvents, sizeof(ReplayEvent), replayHeader.eventCount, f) == replayHeader.eventCount &&
+             fread(&replayBoard, sizeof(replayBoard), 1, f) == 1;
+    }
+    replayHeader.name[15] = '\0';
+
+    fclose(f);
+    return ok;
+}
+
+void ReplayStoreBoard() {
+    replayBoard.playerCount = playerCount;
+    replayBoard.playerRank = playerRank;
+    replayBoard.playerBest = playerBest;
+    replayBoard.rankedPlayerCount = rankedPlayerCount;
+    replayBoard.neighborCount = neighborCount;
+    memcpy(replayBoard.players, players, sizeof(players));
+    memcpy(replayBoard.neighbors, neighbors, sizeof(neighbors));
+    memcpy(replayBoard.neighborRanks, neighborRanks, sizeof(neighborRanks));
+}
+
+// Playback: show the board the player saw, not today's index
+void ReplayRestoreBoard() {
+    playerCount = replayBoard.playerCount;
+    playerRank = replayBoard.playerRank;
+    playerBest = replayBoard.playerBest;
+    rankedPlayerCount = replayBoard.rankedPlayerCount;
+    neighborCount = replayBoard.neighborCount;
+    memcpy(players, replayBoard.players, sizeof(players));
+    memcpy(neighbors, replayBoard.neighbors, sizeof(neighbors));
+    memcpy(neighborRanks, replayBoard.neighborRanks, sizeof(neighborRanks));
+}
+
+// Simulation thread, after UpdateGame(): log what this tick consumed and
+// write the file out once the run is won
+void ReplayRecordTick() {
+    if (!replayRecording) return;
+
+    if (replayTick >= 0) {
+        for (int i = 0; i < tickInput.keyCount; i++) ReplayAppend(replayTick, tickInput.keys[i], 0);
+        for (int i = 0; i < tickInput.charCount; i++) ReplayAppend(replayTick, 0, tickInput.chars[i]);
+        replayHeader.tickCount = replayTick + 1;
+    }
+    replayTick++;
+
+    if (currentState == STATE_VICTORY) {
+        ReplayStoreBoard();
+
+        // Not TextFormat(): its buffer is shared with the render thread
+        char path[64];
+        snprintf(path, sizeof(path), "run_%lld_%d.pfr", (long long)time(NULL), currentSessionScore);
+        if (!ReplaySave(path)) printf("Could not save replay %s\n", path);
+        replayRecording = false;
+    }
+}
+
+// Playback: fill this tick's input from the loaded events
+void ReplayFeedTick(uint32_t tick) {
+    tickInput.keyCount = 0;
+    tickInput.charCount = 0;
+    tickInput.charRead = 0;
+
+    while (replayCursor < replayHeader.eventCount && replayEvents[replayCursor].tick == tick) {
+        ReplayEvent e = replayEvents[replayCursor++];
+        if (e.key != 0 && tickInput.keyCount < MAX_TICK_KEYS) {
+            tickInput.keys[tickInput.keyCount++] = e.key;
+        } else if (e.key == 0 && tickInput.charCount < MAX_TICK_CHARS) {
+            tickInput.chars[tickInput.charCount++] = e.character;
+        }
+    }
+}
+
+// ==========================================
+//          SETUP FUNCTIONS
+// ==========================================
+
+void SetupLevels() {
+    // ---------------- LEVEL 1 ----------------
+    levels[0].pipeCount = 5;
+    levels[0].ghostCount  = 1;
+    levels[0].pelletCount = 1;
+    levels[0].speed     = REAL(3.0);
+    levels[0].gapSize   = REAL(160.0);
+    levels[0].gravity   = REAL(0.4);
+    levels[0].color     = SKYBLUE;
+
+    // ---------------- LEVEL 2 (Moving Pipes) ----------------
+    levels[1].pipeCount = 10;
+    levels[1].ghostCount  = 3;
+    levels[1].pelletCount = 2;
+    levels[1].speed     = REAL(3.5);
+    levels[1].gapSize   = REAL(150.0);
+    levels[1].gravity   = REAL(0.45);
+    levels[1].color     = LIME;
+}
+
+void ResetEntityPositions() {
+    LevelData cur = levels[currentLevel];
+
+    pacmanY = RealFromInt(SCREEN_HEIGHT / 2);
+    pacmanVelocityY = 0;
+    mouthPhase = 0;
+    powerTicks = 0;
+    simTick = 0;
+
+    ClearEntities();
+
+    // Generate Pipes
+    for (int i = 0; i < cur.pipeCount; i++) {
+        int row = CreateEntity(ARCH_PIPE, NULL);
+        if (row < 0) break;
+
+        pipes.x[row] = RealFromInt(SCREEN_WIDTH + 300 + (i * SLOT_SPACING));
+        pipes.phase[row] = RealFromInt(i);
+
+        int minGap = 50;
+        int maxGap = SCREEN_HEIGHT - 50 - RealToInt(cur.gapSize);
+        if (maxGap < minGap) maxGap = minGap + 10;
+
+        Real randomY = RealFromInt(minGap + RunRandom(maxGap - minGap));
+
+        pipes.gapY[row] = randomY;
+        pipes.baseGapY[row] = randomY;
+
+        // Orb Logic
+        pipes.orbCollected[row] = false;
+        int padding = 20;
+        int safeRange = RealToInt(cur.gapSize) - (padding * 2);
+
+        if (safeRange > 0) {
+            pipes.orbRelY[row] = RealFromInt(padding + RunRandom(safeRange));
+        } else {
+            pipes.orbRelY[row] = cur.gapSize / 2;
+        }
+
+        pipes.passed[row] = false;
+    }
+
+    // Ghosts and pellets sit halfway between pipes: pellets on slots 0, 4, 8...
+    // and ghosts on the odd slots so the two never overlap
+    int firstSlotX = SCREEN_WIDTH + 300 + PIPE_WIDTH + (SLOT_SPACING - PIPE_WIDTH) / 2;
+
+    for (int i = 0; i < cur.pelletCount; i++) {
+        int row = CreateEntity(ARCH_PELLET, NULL);
+        if (row < 0) break;
+
+        pellets.x[row] = RealFromInt(firstSlotX + (i * 4) * SLOT_SPACING);
+        pellets.y[row] = RealFromInt(80 + RunRandom(SCREEN_HEIGHT - 160));
+    }
+
+    Color palette[4] = { RED, PINK, SKYBLUE, ORANGE };
+    for (int i = 0; i < cur.ghostCount; i++) {
+        int row = CreateEntity(ARCH_GHOST, NULL);
+        if (row < 0) break;
+
+        ghosts.x[row] = RealFromInt(firstSlotX + (1 + i * 2) * SLOT_SPACING);
+        ghosts.y[row] = RealFromInt(60 + RunRandom(SCREEN_HEIGHT - 120));
+        ghosts.velY[row] = 0;
+        ghosts.color[row] = palette[i % 4];
+    }
+}
+
+// ==========================================
+//          UPDATE LOGIC
+// ==========================================
+
+// Stores the run and pulls the top list plus the players around you
+void RecordVictory() {
+    int32_t id = PlayerIndexRecord(tempName, currentSessionScore);
+
+    IndexNode me;
+    LoadNode(id, &me);
+    playerBest = me.best;
+    playerRank = PlayerIndexRank(id);
+    rankedPlayerCount = indexHeader.nodeCount;
+
+    playerCount = 0;
+    while (playerCount < MAX_PLAYERS && PlayerIndexSelect(playerCount + 1, &players[playerCount])) {
+        playerCount++;
+    }
+
+    neighborCount = 0;
+    for (int r = playerRank - NEIGHBOR_SPAN; r <= playerRank + NEIGHBOR_SPAN; r++) {
+        if (PlayerIndexSelect(r, &neighbors[neighborCount])) {
+            neighborRanks[neighborCount] = r;
+            neighborCount++;
+        }
+    }
+}
+
+// Reseeds per run so a replay only needs the seed and the inputs
+void StartRun(uint32_t seed) {
+    SeedRunRandom(seed);
+    runTick = 0;
+    ReplayBegin(seed);
+
+    currentState = STATE_TITLE;
+    currentSessionScore = 0;
+    levelStartScore = 0;
+    currentLevel = 0;
+    ResetEntityPositions();
+}
+
+void UpdateInput() {
+    int key = TickCharPressed();
+
+    while (key > 0) {
+        if ((key >= 32) && (key <= 125) && (letterCount < 15)) {
+            tempName[letterCount] = (char)key;
+            tempName[letterCount+1] = '\0';
+            letterCount++;
+        }
+        key = TickCharPressed();
+    }
+
+    if (TickKeyPressed(KEY_BACKSPACE)) {
+        letterCount--;
+        if (letterCount < 0) letterCount = 0;
+        tempName[letterCount] = '\0';
+    }
+
+    if (TickKeyPressed(KEY_ENTER) && letterCount > 0) {
+        StartRun((uint32_t)time(NULL));
+    }
+}
+
+// ------------------------------------------
+//  Systems (each walks its tables linearly)
+// ------------------------------------------
+
+Box PacmanHitbox() {
+    Box player = {
+        REAL(PACMAN_X_POS - PACMAN_RADIUS + 5), pacmanY - REAL(PACMAN_RADIUS - 5),
+        REAL(PACMAN_RADIUS*2 - 10), REAL(PACMAN_RADIUS*2 - 10)
+    };
+    return player;
+}
+
+void MovementSystem(LevelData cur) {
+    // Pipes scroll (and oscillate on Level 2)
+    for (int i = 0; i < pipes.count; i++) {
+        pipes.x[i] -= cur.speed;
+    }
+    if (currentLevel == 1) {
+        // 3 rad/s at 60 ticks per second
+        Real time = simTick * REAL(3.0 / FPS);
+        for (int i = 0; i < pipes.count; i++) {
+            pipes.gapY[i] = pipes.baseGapY[i] + RealSin(time + pipes.phase[i]) * 50;
+        }
+    }
+
+    // Ghosts drift in faster than the world and steer towards Pacman
+    for (int i = 0; i < ghosts.count; i++) {
+        Real accel = (pacmanY > ghosts.y[i]) ? REAL(GHOST_ACCEL) : -REAL(GHOST_ACCEL);
+        if (powerTicks > 0) accel = -accel; // Frightened ghosts flee
+
+        ghosts.velY[i] += accel;
+        if (ghosts.velY[i] >  REAL(GHOST_MAX_VY)) ghosts.velY[i] =  REAL(GHOST_MAX_VY);
+        if (ghosts.velY[i] < -REAL(GHOST_MAX_VY)) ghosts.velY[i] = -REAL(GHOST_MAX_VY);
+
+        ghosts.x[i] -= cur.speed + REAL(GHOST_DRIFT);
+        ghosts.y[i] += ghosts.velY[i];
+        if (ghosts.y[i] < REAL(GHOST_RADIUS)) ghosts.y[i] = REAL(GHOST_RADIUS);
+        if (ghosts.y[i] > REAL(SCREEN_HEIGHT - GHOST_RADIUS)) ghosts.y[i] = REAL(SCREEN_HEIGHT - GHOST_RADIUS);
+    }
+
+    for (int i = 0; i < pellets.count; i++) {
+        pellets.x[i] -= cur.speed;
+    }
+}
+
+void PipeSystem(LevelData cur, Box player) {
+    for (int i = 0; i < pipes.count; i++) {
+        // Collision Rectangles (a power pellet makes Pacman pass through)
+        if (powerTicks == 0) {
+            Box topPipe = { pipes.x[i], 0, RealFromInt(PIPE_WIDTH), pipes.gapY[i] };
+            Box botPipe = { pipes.x[i], pipes.gapY[i] + cur.gapSize, RealFromInt(PIPE_WIDTH), RealFromInt(SCREEN_HEIGHT) };
+
+            if (BoxesOverlap(topPipe, player) || BoxesOverlap(botPipe, player)) {
+                currentState = STATE_GAMEOVER;
+            }
+        }
+
+        // Orb Collection
+        if (!pipes.orbCollected[i]) {
+            Box orbHitbox = {
+                pipes.x[i] + RealFromInt((PIPE_WIDTH / 2) - 5),
+                pipes.gapY[i] + pipes.orbRelY[i] - RealFromInt(5),
+                RealFromInt(10), RealFromInt(10)
+            };
+            if (BoxesOverlap(player, orbHitbox)) {
+                pipes.orbCollected[i] = true;
+                currentSessionScore += 5;
+            }
+        }
+
+        // Score Update (Passing Pipe)
+        if (!pipes.passed[i] && pipes.x[i] + RealFromInt(PIPE_WIDTH) < REAL(PACMAN_X_POS)) {
+            pipes.passed[i] = true;
+            currentSessionScore += 1;
+        }
+    }
+}
+
+void GhostSystem(Box player) {
+    for (int i = 0; i < ghosts.count; i++) {
+        Box ghostHitbox = {
+            ghosts.x[i] - REAL(GHOST_RADIUS - 4), ghosts.y[i] - REAL(GHOST_RADIUS - 4),
+            REAL(GHOST_RADIUS*2 - 8), REAL(GHOST_RADIUS*2 - 8)
+        };
+
+        if (BoxesOverlap(player, ghostHitbox)) {
+            if (powerTicks > 0) {
+                currentSessionScore += 10;
+                QueueDestroy(ARCH_GHOST, i);
+            } else {
+                currentState = STATE_GAMEOVER;
+            }
+        }
+        else if (ghosts.x[i] < -REAL(GHOST_RADIUS * 2)) {
+            QueueDestroy(ARCH_GHOST, i);
+        }
+    }
+}
+
+void PelletSystem(Box player) {
+    for (int i = 0; i < pellets.count; i++) {
+        Box pelletHitbox = {
+            pellets.x[i] - REAL(PELLET_RADIUS), pellets.y[i] - REAL(PELLET_RADIUS),
+            REAL(PELLET_RADIUS*2), REAL(PELLET_RADIUS*2)
+        };
+
+        if (BoxesOverlap(player, pelletHitbox)) {
+            powerTicks = POWER_TICKS;
+            currentSessionScore += 2;
+            QueueDestroy(ARCH_PELLET, i);
+        }
+        else if (pellets.x[i] < -REAL(PELLET_RADIUS * 2)) {
+            QueueDestroy(ARCH_PELLET, i);
+        }
+    }
+}
+
+void UpdateGame() {
+    // StartRun() zeroes this mid-tick, so the tick after it is 1 in both
+    // live and replayed runs
+    runTick++;
+
+    if (currentState == STATE_INPUT) {
+        UpdateInput();
+        return;
+    }
+
+    // State Transitions via Spacebar
+    if (TickKeyPressed(KEY_SPACE)) {
+        if (currentState == STATE_TITLE) {
+            currentState = STATE_PLAYING;
+            pacmanVelocityY = REAL(JUMP_STRENGTH);
+        }
+        else if (currentState == STATE_LEVEL_DONE) {
+            currentLevel++;
+            if (currentLevel >= MAX_LEVELS) {
+                // VICTORY LOGIC
+                currentState = STATE_VICTORY;
+
+                if (replayPlayback) {
+                    ReplayRestoreBoard();
+                } else if (indexFile) {
+                    RecordVictory();
+                } else {
+                    // No index on disk: fall back to this session's list
+
+                    // 1. Add Player to Scoreboard
+                    if (playerCount < MAX_PLAYERS) {
+                        strcpy(players[playerCount].name, tempName);
+                        players[playerCount].score = currentSessionScore;
+                        players[playerCount].active = true;
+                        playerCount++;
+                    }
+
+                    // 2. SORT SCOREBOARD (Bubble Sort: Highest to Lowest)
+                    for (int i = 0; i < playerCount - 1; i++) {
+                        for (int j = 0; j < playerCount - i - 1; j++) {
+                            if (players[j].score < players[j+1].score) {
+                                // Swap entire struct
+                                PlayerData temp = players[j];
+                                players[j] = players[j+1];
+                                players[j+1] = temp;
+                            }
+                        }
+                    }
+
+                    playerRank = 0;
+                    for (int i = 0; i < playerCount; i++) {
+                        if (strcmp(players[i].name, tempName) == 0 && players[i].score == currentSessionScore) {
+                            playerRank = i + 1;
+                            break;
+                        }
+                    }
+                    playerBest = currentSessionScore;
+                    rankedPlayerCount = playerCount;
+                    neighborCount = 0;
+                }
+
+            } else {
+                currentState = STATE_TITLE;
+                levelStartScore = currentSessionScore;
+                ResetEntityPositions();
+            }
+        }
+        else if (currentState == STATE_GAMEOVER) {
+            // Retry Level
+            currentSessionScore = levelStartScore;
+            currentState = STATE_TITLE;
+            ResetEntityPositions();
+        }
+        else if (currentState == STATE_VICTORY) {
+            // Return to input screen for new player
+            currentState = STATE_INPUT;
+            letterCount = 0;
+            tempName[0] = '\0';
+        }
+    }
+
+    if (currentState != STATE_PLAYING) return;
+
+    LevelData cur = levels[currentLevel];
+
+    // 1. Update Player
+    pacmanVelocityY += cur.gravity;
+    if (TickKeyPressed(KEY_SPACE)) pacmanVelocityY = REAL(JUMP_STRENGTH);
+    pacmanY += pacmanVelocityY;
+
+    if (powerTicks > 0) powerTicks--;
+
+    // Animation
+    mouthPhase += MOUTH_PHASE_STEP;
+    currentMouthAngle = mouthAngles[MouthFrame()];
+
+    // Bounds Collision
+    if (pacmanY - REAL(PACMAN_RADIUS) <= 0 || pacmanY + REAL(PACMAN_RADIUS) >= RealFromInt(SCREEN_HEIGHT)) {
+        currentState = STATE_GAMEOVER;
+    }
+
+    // 2. Update Entities
+    Box player = PacmanHitbox();
+
+    simTick++;
+    MovementSystem(cur);
+    PipeSystem(cur, player);
+    GhostSystem(player);
+    PelletSystem(player);
+    FlushDestroyQueue();
+
+    int pipesClearedCount = 0;
+    for (int i = 0; i < pipes.count; i++) {
+        if (pipes.passed[i]) pipesClearedCount++;
+    }
+
+    if (pipesClearedCount >= cur.pipeCount) {
+        currentState = STATE_LEVEL_DONE;
+    }
+}
+
+// ==========================================
+//          FRAME PACING
+// ==========================================
+// The scene is drawn into an off-screen target sized to fit the window
+// (letterboxed to 16:9). When render work runs over budget, only a
+// shrinking top-left region of it is used, then stretched back up; the
+// region grows again once frames are comfortably fast.
+//
+// Instead of raylib's fixed sleep, frames are paced against an absolute
+// schedule: sleep until a small margin before the deadline, then spin,
+// yielding so a software rasterizer can still use the core. The margin
+// tracks how late the OS actually wakes us, and a frame that misses its
+// deadline resyncs instead of bursting to catch up.
+
+typedef struct {
+    double interval;
+    double deadline;
+    double spinMargin;      // Sleeping stops this far before the deadline
+    double lastPresent;
+    int missed;             // Deadlines missed, ever
+    float jitterMs;         // Mean |present interval - target| over the last second,
+                            // timed when EndDrawing() returns
+    double jitterSum;
+    int jitterCount;
+    double windowStart;
+} FramePacer;
+
+const float resolutionScales[] = { 1.0f, 0.85f, 0.7f, 0.5f, 0.35f };
+#define SCALE_LEVELS ((int)(sizeof(resolutionScales) / sizeof(resolutionScales[0])))
+
+RenderTexture2D sceneTarget;
+bool sceneTargetLoaded = false;
+Rectangle sceneViewport;    // Where the scene lands in the window
+int scaleLevel = 0;
+int slowFrames = 0;
+int fastFrames = 0;
+FramePacer pacer;
+
+void PacerInit(FramePacer *p, int fps) {
+    memset(p, 0, sizeof(*p));
+    p->interval = 1.0 / fps;
+    p->spinMargin = PACER_MAX_SPIN;
+    p->deadline = NowSeconds() + p->interval;
+    p->lastPresent = p->windowStart = NowSeconds();
+}
+
+// Call once per frame with the time EndDrawing() returned
+void PacerWait(FramePacer *p, double presentTime) {
+    p->jitterSum += fabs((presentTime - p->lastPresent) - p->interval);
+    p->jitterCount++;
+    p->lastPresent = presentTime;
+    if (presentTime - p->windowStart >= 1.0) {
+        p->jitterMs = (float)(p->jitterSum / p->jitterCount * 1000.0);
+        p->jitterSum = 0;
+        p->jitterCount = 0;
+        p->windowStart = presentTime;
+    }
+
+    double now = NowSeconds();
+
+    if (now > p->deadline) {
+        p->missed++;
+        p->deadline = now;
+    } else {
+        double target = p->deadline - p->spinMargin;
+        if (target > now) {
+            SleepSeconds(target - now);
+
+            // Widen the margin quickly when the OS oversleeps, narrow it slowly
+            double oversleep = NowSeconds() - target;
+            if (oversleep * 1.5 > p->spinMargin) p->spinMargin = oversleep * 1.5;
+            else p->spinMargin *= 0.99;
+            if (p->spinMargin < PACER_MIN_SPIN) p->spinMargin = PACER_MIN_SPIN;
+            if (p->spinMargin > PACER_MAX_SPIN) p->spinMargin = PACER_MAX_SPIN;
+        }
+        while (NowSeconds() < p->deadline) sched_yield();
+    }
+
+    p->deadline += p->interval;
+}
+
+// Steps the internal resolution from how long the last frame's work took
+void AdaptResolution(float workMs) {
+    float budget = 1000.0f / FPS;
+
+    if (workMs > budget * SCALE_SLOW_BUDGET) {
+        slowFrames++;
+        fastFrames = 0;
+    } else if (workMs < budget * SCALE_FAST_BUDGET) {
+        fastFrames++;
+        slowFrames = 0;
+    } else {
+        slowFrames = 0;
+        fastFrames = 0;
+    }
+
+    if (slowFrames >= SCALE_DOWN_FRAMES && scaleLevel < SCALE_LEVELS - 1) {
+        scaleLevel++;
+        slowFrames = 0;
+    } else if (fastFrames >= SCALE_UP_FRAMES && scaleLevel > 0) {
+        scaleLevel--;
+        fastFrames = 0;
+    }
+}
+
+// Keeps the scene target matching the letterboxed window area
+void UpdateSceneTarget() {
+    float windowW = GetScreenWidth();
+    float windowH = GetScreenHeight();
+    float fit = fminf(windowW / SCREEN_WIDTH, windowH / SCREEN_HEIGHT);
+    if (fit <= 0) return;
+
+    sceneViewport.width = SCREEN_WIDTH * fit;
+    sceneViewport.height = SCREEN_HEIGHT * fit;
+    sceneViewport.x = (windowW - sceneViewport.width) / 2;
+    sceneViewport.y = (windowH - sceneViewport.height) / 2;
+
+    int w = (int)sceneViewport.width;
+    int h = (int)sceneViewport.height;
+    if (sceneTargetLoaded && sceneTarget.texture.width == w && sceneTarget.texture.height == h) return;
+
+    if (sceneTargetLoaded) UnloadRenderTexture(sceneTarget);
+    sceneTarget = LoadRenderTexture(w, h);
+    SetTextureFilter(sceneTarget.texture, TEXTURE_FILTER_BILINEAR);
+    sceneTargetLoaded = true;
+}
+
+// ==========================================
+//          GEOMETRY CACHE
+// ==========================================
+// Built once after the window opens: every Pacman mouth keyframe at every
+// tilt bucket, the ghost body and eyes, the orb, the pellet pulse frames
+// and a solid white block, all tessellated once into a single atlas. While
+// the cache is on, raylib also draws its shapes from that white block, so
+// pipes and sprites share one texture and the playfield is two triangles
+// per sprite instead of a fan per circle.
+
+Texture2D atlas;
+bool geometryCacheReady = false;
+bool useGeometryCache = true;   // F4 flips back to per-frame tessellation
+
+int sceneTriangles = 0;         // Triangles submitted for the playfield
+float sceneCpuMs = 0;
+
+#define QUAD_TRIANGLES   2
+#define CIRCLE_TRIANGLES 36         // DrawCircle() always uses 36 segments
+
+// Triangles DrawCircleSector() emits, using raylib's own segment count
+// (rshapes.c, SMOOTH_CIRCLE_ERROR_RATE 0.5) when too few are asked for
+int SectorTriangles(float radius, float startAngle, float endAngle, int segments) {
+    int minSegments = (int)ceilf((endAngle - startAngle) / 90.0f);
+    if (segments < minSegments) {
+        float th = acosf(2.0f * powf(1.0f - 0.5f / radius, 2.0f) - 1.0f);
+        segments = (int)((endAngle - startAngle) * ceilf(2.0f * PI / th) / 360.0f);
+        if (segments <= 0) segments = minSegments;
+    }
+    return segments;
+}
+
+// Atlas layout: Pacman grid on the left, everything else in a column right of it
+#define SPRITE_COLUMN_X (MOUTH_FRAMES * PACMAN_CELL)
+
+Rectangle PacmanCell(int frame, int bucket) {
+    return (Rectangle){ frame * PACMAN_CELL, bucket * PACMAN_CELL, PACMAN_CELL, PACMAN_CELL };
+}
+
+Rectangle GhostBodyCell() {
+    return (Rectangle){ SPRITE_COLUMN_X, 0, GHOST_CELL, GHOST_CELL };
+}
+
+Rectangle GhostEyesCell() {
+    return (Rectangle){ SPRITE_COLUMN_X + GHOST_CELL, 0, GHOST_CELL, GHOST_CELL };
+}
+
+Rectangle OrbCell() {
+    return (Rectangle){ SPRITE_COLUMN_X, GHOST_CELL, ORB_CELL, ORB_CELL };
+}
+
+Rectangle PelletCell(int frame) {
+    return (Rectangle){ SPRITE_COLUMN_X + frame * PELLET_CELL, GHOST_CELL + ORB_CELL, PELLET_CELL, PELLET_CELL };
+}
+
+Rectangle WhiteCell() {
+    return (Rectangle){ SPRITE_COLUMN_X, GHOST_CELL + ORB_CELL + PELLET_CELL, 4, 4 };
+}
+
+Vector2 CellCenter(Rectangle cell) {
+    return (Vector2){ cell.x + cell.width / 2, cell.y + cell.height / 2 };
+}
+
+int TiltBucket(float velocityY) {
+    float tilt = velocityY * 3.0f;
+    int bucket = (int)lrintf((tilt - TILT_MIN) / TILT_STEP);
+    if (bucket < 0) bucket = 0;
+    if (bucket > TILT_BUCKETS - 1) bucket = TILT_BUCKETS - 1;
+    return bucket;
+}
+
+int PelletFrame(float time) {
+    // The pulse runs at 8 rad/s
+    int frame = (int)(time * 8.0f / (2.0f * PI) * PELLET_FRAMES);
+    return frame % PELLET_FRAMES;
+}
+
+// raylib's own 1x1 white texel. Older raylib ignores a zero texture id in
+// SetShapesTexture(), so the default is named explicitly.
+void UseDefaultShapesTexture() {
+    Texture2D texel = { rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    SetShapesTexture(texel, (Rectangle){ 0, 0, 1, 1 });
+}
+
+// F4: the immediate path goes back to the default texture so the two
+// paths are compared as they would really ship
+void SetGeometryCache(bool enabled) {
+    useGeometryCache = enabled;
+    if (!geometryCacheReady) return;
+
+    if (enabled) {
+        // Sample the middle of the white block so filtering never reaches an edge
+        Rectangle white = WhiteCell();
+        SetShapesTexture(atlas, (Rectangle){ white.x + 1, white.y + 1, 2, 2 });
+    } else {
+        UseDefaultShapesTexture();
+    }
+}
+
+void BuildGeometryCache() {
+    RenderTexture2D target = LoadRenderTexture(ATLAS_WIDTH, ATLAS_HEIGHT);
+    BeginTextureMode(target);
+    ClearBackground(BLANK);
+
+    // Pacman: mouth keyframes x tilt buckets, tessellated finely once
+    for (int frame = 0; frame < MOUTH_FRAMES; frame++) {
+        for (int bucket = 0; bucket < TILT_BUCKETS; bucket++) {
+            float mouth = mouthAngles[frame];
+            float tilt = TILT_MIN + bucket * TILT_STEP;
+            DrawCircleSector(CellCenter(PacmanCell(frame, bucket)), PACMAN_RADIUS,
+                             mouth + tilt, (360.0f - mouth) + tilt, 48, YELLOW);
+        }
+    }
+
+    // Ghost body is white so each ghost can be tinted; eyes stay untinted
+    Vector2 body = CellCenter(GhostBodyCell());
+    DrawCircleSector(body, GHOST_RADIUS, 180.0f, 360.0f, 24, WHITE);
+    DrawRectangle(body.x - GHOST_RADIUS, body.y, GHOST_RADIUS*2, GHOST_RADIUS, WHITE);
+
+    Vector2 eyes = CellCenter(GhostEyesCell());
+    DrawCircle(eyes.x - 6, eyes.y - 3, 4, WHITE);
+    DrawCircle(eyes.x + 6, eyes.y - 3, 4, WHITE);
+    DrawCircle(eyes.x - 8, eyes.y - 3, 2, DARKBLUE);
+    DrawCircle(eyes.x + 4, eyes.y - 3, 2, DARKBLUE);
+
+    Vector2 orb = CellCenter(OrbCell());
+    DrawCircle(orb.x, orb.y, 5, WHITE);
+
+    for (int frame = 0; frame < PELLET_FRAMES; frame++) {
+        float pulse = PELLET_RADIUS - 2.0f + 2.0f * sinf(2.0f * PI * (frame + 0.5f) / PELLET_FRAMES);
+        Vector2 c = CellCenter(PelletCell(frame));
+        DrawCircle(c.x, c.y, pulse, WHITE);
+    }
+
+    Rectangle white = WhiteCell();
+    DrawRectangle(white.x, white.y, white.width, white.height, WHITE);
+    EndTextureMode();
+
+    // Copy into a plain texture so cells read top-down like any sprite sheet
+    Image img = LoadImageFromTexture(target.texture);
+    ImageFlipVertical(&img);
+    atlas = LoadTextureFromImage(img);
+    UnloadImage(img);
+    UnloadRenderTexture(target);
+
+    SetTextureFilter(atlas, TEXTURE_FILTER_BILINEAR);
+
+    geometryCacheReady = true;
+    SetGeometryCache(useGeometryCache);
+}
+
+void UnloadGeometryCache() {
+    if (!geometryCacheReady) return;
+    UseDefaultShapesTexture();
+    UnloadTexture(atlas);
+    geometryCacheReady = false;
+}
+
+// ==========================================
+//          DRAWING
+// ==========================================
+
+void DrawPipes(const FrameSnapshot *s, LevelData cur) {
+    float gapSize = RealToFloat(cur.gapSize);
+    int border = 4; // Outline thickness
+
+    for (int i = 0; i < s->pipeCount; i++) {
+        float x = s->pipeX[i];
+        float gapY = s->pipeGapY[i];
+        if (x > -PIPE_WIDTH && x < SCREEN_WIDTH) {
+            // Top Pipe
+            DrawRectangle(x, 0, PIPE_WIDTH, gapY, cur.color);
+            DrawRectangle(x + border, 0, PIPE_WIDTH - border*2, gapY - border, BLACK);
+
+            // Bottom Pipe
+            float bottomY = gapY + gapSize;
+            float bottomHeight = SCREEN_HEIGHT - bottomY;
+            DrawRectangle(x, bottomY, PIPE_WIDTH, bottomHeight, cur.color);
+            DrawRectangle(x + border, bottomY + border, PIPE_WIDTH - border*2, bottomHeight - border, BLACK);
+            sceneTriangles += 4 * QUAD_TRIANGLES;
+        }
+    }
+}
+
+Color GhostBodyColor(const FrameSnapshot *s, int i) {
+    // Blue while frightened, blinking as the power runs out
+    if (s->powerTicks <= 0) return s->ghostColor[i];
+    bool blink = s->powerTicks < FPS && (s->powerTicks / 8) % 2 == 0;
+    return blink ? WHITE : BLUE;
+}
+
+// Reference path: tessellates every shape every frame
+void DrawEntitiesImmediate(const FrameSnapshot *s, LevelData cur, float time) {
+    DrawPipes(s, cur);
+
+    // Orbs
+    for (int i = 0; i < s->pipeCount; i++) {
+        float x = s->pipeX[i];
+        if (!s->orbCollected[i] && x > -PIPE_WIDTH && x < SCREEN_WIDTH) {
+            float finalOrbY = s->pipeGapY[i] + s->orbRelY[i];
+            DrawCircle(x + (PIPE_WIDTH/2), finalOrbY, 5, WHITE);
+            sceneTriangles += CIRCLE_TRIANGLES;
+        }
+    }
+
+    // Power Pellets
+    for (int i = 0; i < s->pelletCount; i++) {
+        float px = s->pelletX[i];
+        if (px > -PELLET_RADIUS && px < SCREEN_WIDTH + PELLET_RADIUS) {
+            float pulse = PELLET_RADIUS - 2.0f + 2.0f * sinf(time * 8.0f);
+            DrawCircle(px, s->pelletY[i], pulse, WHITE);
+            sceneTriangles += CIRCLE_TRIANGLES;
+        }
+    }
+
+    // Ghosts
+    for (int i = 0; i < s->ghostCount; i++) {
+        float gx = s->ghostX[i];
+        float gy = s->ghostY[i];
+        if (gx < -GHOST_RADIUS || gx > SCREEN_WIDTH + GHOST_RADIUS) continue;
+
+        Color body = GhostBodyColor(s, i);
+        DrawCircleSector((Vector2){gx, gy}, GHOST_RADIUS, 180.0f, 360.0f, 0, body);
+        DrawRectangle(gx - GHOST_RADIUS, gy, GHOST_RADIUS*2, GHOST_RADIUS, body);
+
+        // Eyes look towards Pacman
+        DrawCircle(gx - 6, gy - 3, 4, WHITE);
+        DrawCircle(gx + 6, gy - 3, 4, WHITE);
+        DrawCircle(gx - 8, gy - 3, 2, DARKBLUE);
+        DrawCircle(gx + 4, gy - 3, 2, DARKBLUE);
+        sceneTriangles += SectorTriangles(GHOST_RADIUS, 180.0f, 360.0f, 0) + QUAD_TRIANGLES + 4 * CIRCLE_TRIANGLES;
+    }
+
+    // Pacman
+    float tilt = s->pacmanVelocityY * 3.0f;
+    if (tilt > 35.0f) tilt = 35.0f;
+    if (tilt < -25.0f) tilt = -25.0f;
+
+    DrawCircleSector((Vector2){PACMAN_X_POS, s->pacmanY}, PACMAN_RADIUS,
+                    s->mouthAngle + tilt, (360.0f - s->mouthAngle) + tilt, 0, YELLOW);
+    sceneTriangles += SectorTriangles(PACMAN_RADIUS, s->mouthAngle + tilt, (360.0f - s->mouthAngle) + tilt, 0);
+}
+
+// Cached path: one textured quad per sprite, all from the atlas
+void DrawEntitiesCached(const FrameSnapshot *s, LevelData cur, float time) {
+    DrawPipes(s, cur);
+
+    Rectangle orbCell = OrbCell();
+    for (int i = 0; i < s->pipeCount; i++) {
+        float x = s->pipeX[i];
+        if (!s->orbCollected[i] && x > -PIPE_WIDTH && x < SCREEN_WIDTH) {
+            Vector2 pos = { x + (PIPE_WIDTH/2) - ORB_CELL / 2.0f, s->pipeGapY[i] + s->orbRelY[i] - ORB_CELL / 2.0f };
+            DrawTextureRec(atlas, orbCell, pos, WHITE);
+            sceneTriangles += QUAD_TRIANGLES;
+        }
+    }
+
+    Rectangle pelletCell = PelletCell(PelletFrame(time));
+    for (int i = 0; i < s->pelletCount; i++) {
+        float px = s->pelletX[i];
+        if (px > -PELLET_RADIUS && px < SCREEN_WIDTH + PELLET_RADIUS) {
+            Vector2 pos = { px - PELLET_CELL / 2.0f, s->pelletY[i] - PELLET_CELL / 2.0f };
+            DrawTextureRec(atlas, pelletCell, pos, WHITE);
+            sceneTriangles += QUAD_TRIANGLES;
+        }
+    }
+
+    Rectangle bodyCell = GhostBodyCell();
+    Rectangle eyesCell = GhostEyesCell();
+    for (int i = 0; i < s->ghostCount; i++) {
+        float gx = s->ghostX[i];
+        if (gx < -GHOST_RADIUS || gx > SCREEN_WIDTH + GHOST_RADIUS) continue;
+
+        Vector2 pos = { gx - GHOST_CELL / 2.0f, s->ghostY[i] - GHOST_CELL / 2.0f };
+        DrawTextureRec(atlas, bodyCell, pos, GhostBodyColor(s, i));
+        DrawTextureRec(atlas, eyesCell, pos, WHITE);
+        sceneTriangles += 2 * QUAD_TRIANGLES;
+    }
+
+    Rectangle pacmanCell = PacmanCell(s->mouthFrame, TiltBucket(s->pacmanVelocityY));
+    Vector2 pos = { PACMAN_X_POS - PACMAN_CELL / 2.0f, s->pacmanY - PACMAN_CELL / 2.0f };
+    DrawTextureRec(atlas, pacmanCell, pos, WHITE);
+    sceneTriangles += QUAD_TRIANGLES;
+}
+
+void DrawStats(const FrameSnapshot *s) {
+    const LoopStats *sim = &s->simStats;
+    const LoopStats *ren = &renderStats;
+    int x = GetScreenWidth() - 240;
+
+    DrawRectangle(x - 10, 5, 245, 135, (Color){ 0, 0, 0, 200 });
+    DrawText(TextFormat("SIM    %5.1f Hz  %5.2f ms", sim->rateHz, sim->avgMs), x, 12, 10, GREEN);
+    DrawText(TextFormat("       peak %5.2f ms  late %d", sim->peakMs, sim->overruns), x, 26, 10, GREEN);
+    DrawText(TextFormat("RENDER %5.1f Hz  %5.2f ms", ren->rateHz, ren->avgMs), x, 44, 10, SKYBLUE);
+    DrawText(TextFormat("       peak %5.2f ms  late %d", ren->peakMs, ren->overruns), x, 58, 10, SKYBLUE);
+    DrawText(TextFormat("PACING missed %d  jitter %4.2f ms", pacer.missed, pacer.jitterMs), x, 76, 10, SKYBLUE);
+    DrawText(TextFormat("SCALE  %3d%%  (%dx%d)", (int)(resolutionScales[scaleLevel] * 100),
+             (int)(sceneTarget.texture.width * resolutionScales[scaleLevel]),
+             (int)(sceneTarget.texture.height * resolutionScales[scaleLevel])), x, 90, 10, SKYBLUE);
+    DrawText(TextFormat("SCENE  %4d tris  %5.3f ms  %s", sceneTriangles, sceneCpuMs,
+             (geometryCacheReady && useGeometryCache) ? "cached" : "immediate"), x, 104, 10, YELLOW);
+    DrawText(TextFormat("SNAPSHOT frame %u", s->frame), x, 122, 10, WHITE);
+}
+
+// Draws one snapshot into whatever target is bound (window or texture)
+void DrawScene(const FrameSnapshot *s) {
+    ClearBackground(BLACK);
+
+    // Animation clock counts from the start of the run so offline renders match
+    float time = s->runFrame / (float)FPS;
+
+    LevelData cur = levels[s->level];
+
+    if (s->state == STATE_INPUT) {
+        DrawText("WELCOME TO FLAPPY PACMAN", 160, 100, 30, YELLOW);
+        DrawText("Enter your name:", 300, 200, 20, WHITE);
+
+        // Draw Input Box
+        DrawRectangleLines(250, 230, 300, 40, WHITE);
+        DrawText(s->name, 260, 240, 20, YELLOW);
+
+        // Blinking cursor
+        if ((int)(time * 2) % 2 == 0) {
+            DrawText("_", 260 + MeasureText(s->name, 20), 240, 20, YELLOW);
+        }
+
+        DrawText("Press ENTER to Start", 280, 300, 20, DARKGRAY);
+    }
+    else if (s->state == STATE_VICTORY) {
+        DrawText("YOU WIN!", 300, 50, 40, GOLD);
+        DrawText("SCOREBOARD (Top 10)", 80, 110, 20, WHITE);
+        DrawLine(80, 135, 360, 135, WHITE);
+
+        for (int i = 0; i < s->playerCount; i++) {
+            // Highlight the current player's entry
+            Color textColor = (i + 1 == s->playerRank) ? YELLOW : WHITE;
+
+            DrawText(TextFormat("%d. %s", i+1, s->players[i].name), 80, 145 + (i * 26), 20, textColor);
+            DrawText(TextFormat("%d", s->players[i].score), 320, 145 + (i * 26), 20, textColor);
+        }
+
+        DrawText("YOUR STATS", 440, 110, 20, WHITE);
+        DrawLine(440, 135, 720, 135, WHITE);
+        DrawText(TextFormat("This run: %d", s->score), 440, 145, 20, WHITE);
+        DrawText(TextFormat("Personal best: %d", s->playerBest), 440, 171, 20, GOLD);
+        if (s->playerRank > 0) {
+            DrawText(TextFormat("Rank: %d of %d", s->playerRank, s->rankedPlayerCount), 440, 197, 20, WHITE);
+        }
+
+        if (s->neighborCount > 0) {
+            DrawText("AROUND YOU", 440, 235, 20, WHITE);
+            DrawLine(440, 260, 720, 260, WHITE);
+            for (int i = 0; i < s->neighborCount; i++) {
+                Color textColor = (s->neighborRanks[i] == s->playerRank) ? YELLOW : GRAY;
+                DrawText(TextFormat("%d. %s", s->neighborRanks[i], s->neighbors[i].name), 440, 270 + (i * 26), 20, textColor);
+                DrawText(TextFormat("%d", s->neighbors[i].score), 680, 270 + (i * 26), 20, textColor);
+            }
+        }
+
+        DrawText("Press SPACE to Play Again", 260, 420, 20, DARKGRAY);
+    }
+    else {
+        // Draw Game Elements (Pipes, Orbs, Player)
+        double entitiesStart = NowSeconds();
+        sceneTriangles = 0;
+
+        if (geometryCacheReady && useGeometryCache) {
+            DrawEntitiesCached(s, cur, time);
+        } else {
+            DrawEntitiesImmediate(s, cur, time);
+        }
+
+        float entitiesMs = (NowSeconds() - entitiesStart) * 1000.0f;
+        sceneCpuMs = (sceneCpuMs == 0) ? entitiesMs : sceneCpuMs + (entitiesMs - sceneCpuMs) * 0.05f;
+
+        // 3. UI Overlays
+        DrawText(TextFormat("Score: %d", s->score), 10, 10, 20, WHITE);
+        DrawText(TextFormat("Level: %d", s->level + 1), 10, 35, 20, cur.color);
+        if (s->powerTicks > 0) {
+            DrawText(TextFormat("POWER %.1f", s->powerTicks / (float)FPS), 10, 60, 20, BLUE);
+        }
+
+        if (s->state == STATE_GAMEOVER) {
+            DrawText("GAME OVER", 280, 200, 40, RED);
+            DrawText("Press SPACE to Retry Level", 260, 250, 20, WHITE);
+        }
+        else if (s->state == STATE_LEVEL_DONE) {
+            DrawText("LEVEL COMPLETE!", 230, 200, 40, GREEN);
+            DrawText("Press SPACE for Next Level", 260, 250, 20, WHITE);
+        }
+        else if (s->state == STATE_TITLE) {
+            DrawText(TextFormat("LEVEL %d", s->level + 1), 340, 180, 30, cur.color);
+            DrawText("Press SPACE to Fly", 300, 230, 20, WHITE);
+        }
+    }
+
+}
+
+void DrawGame(const FrameSnapshot *s) {
+    UpdateSceneTarget();
+
+    // Render at the current scale into the target's top-left corner
+    float scale = resolutionScales[scaleLevel];
+    float w = (int)(sceneTarget.texture.width * scale);
+    float h = (int)(sceneTarget.texture.height * scale);
+    Camera2D camera = { { 0, 0 }, { 0, 0 }, 0.0f, w / SCREEN_WIDTH };
+
+    BeginTextureMode(sceneTarget);
+    BeginMode2D(camera);
+    DrawScene(s);
+    EndMode2D();
+    EndTextureMode();
+
+    // Render textures are stored bottom-up, hence the negative height
+    Rectangle source = { 0, sceneTarget.texture.height - h, w, -h };
+
+    BeginDrawing();
+    ClearBackground(BLACK);
+    DrawTexturePro(sceneTarget.texture, source, sceneViewport, (Vector2){ 0, 0 }, 0.0f, WHITE);
+    if (showStats) DrawStats(s);
+    EndDrawing();
+}
+
+// ==========================================
+//          OFFLINE RENDER
+// ==========================================
+// Replays a run through the normal game logic and draws every tick with
+// DrawScene() into a hidden render texture, streaming PPM or Y4M frames.
+// No GPU is needed: Mesa's llvmpipe works (LIBGL_ALWAYS_SOFTWARE=1, plus
+// Xvfb on a display-less Linux box). With --jobs N the run is split into
+// N frame ranges rendered by child processes, then stitched in order.
+
+typedef struct {
+    const char *replayPath;
+    const char *outPath;        // NULL = stdout
+    bool y4m;
+    int jobs;
+    int chunkStart;             // Frame range [start, end), end < 0 = all
+    int chunkEnd;
+} RenderOptions;
+
+void WriteY4mHeader(FILE *out) {
+    fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", SCREEN_WIDTH, SCREEN_HEIGHT, FPS);
+}
+
+// 'rgba' is a top-down RGBA8 image; 'scratch' holds W*H*3/2 bytes
+void WriteFrame(FILE *out, const unsigned char *rgba, bool y4m, unsigned char *scratch) {
+    int w = SCREEN_WIDTH;
+    int h = SCREEN_HEIGHT;
+
+    if (!y4m) {
+        fprintf(out, "P6\n%d %d\n255\n", w, h);
+        for (int i = 0; i < w * h; i++) {
+            scratch[i*3 + 0] = rgba[i*4 + 0];
+            scratch[i*3 + 1] = rgba[i*4 + 1];
+            scratch[i*3 + 2] = rgba[i*4 + 2];
+        }
+        fwrite(scratch, 3, w * h, out);
+        return;
+    }
+
+    // Full-range BT.601 in 16.16 integer math, chroma averaged over 2x2
+    unsigned char *yPlane = scratch;
+    unsigned char *uPlane = yPlane + w * h;
+    unsigned char *vPlane = uPlane + (w / 2) * (h / 2);
+
+    for (int i = 0; i < w * h; i++) {
+        int r = rgba[i*4 + 0], g = rgba[i*4 + 1], b = rgba[i*4 + 2];
+        yPlane[i] = (unsigned char)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+    }
+
+    for (int y = 0; y < h / 2; y++) {
+        for (int x = 0; x < w / 2; x++) {
+            int r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    const unsigned char *p = rgba + ((y*2 + dy) * w + (x*2 + dx)) * 4;
+                    r += p[0]; g += p[1]; b += p[2];
+                }
+            }
+            int u = (-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18;
+            int v = ( 32768 * r - 27439 * g -  5329 * b + (128 << 18) + (1 << 17)) >> 18;
+            uPlane[y * (w / 2) + x] = (unsigned char)(u < 0 ? 0 : (u > 255 ? 255 : u));
+            vPlane[y * (w / 2) + x] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+
+    fputs("FRAME\n", out);
+    fwrite(scratch, 1, w * h * 3 / 2, out);
+}
+
+int RenderFrames(RenderOptions opt, bool writeHeader) {
+    int totalFrames = replayHeader.tickCount + REPLAY_TAIL_TICKS;
+    int end = (opt.chunkEnd < 0 || opt.chunkEnd > totalFrames) ? totalFrames : opt.chunkEnd;
+
+    FILE *out = opt.outPath ? fopen(opt.outPath, "wb") : stdout;
+    if (!out) return 1;
+
+    // raylib logs to stdout, which may be carrying the frames
+    SetTraceLogLevel(opt.outPath ? LOG_WARNING : LOG_NONE);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Flappy Pacman - Offline Render");
+    BuildGeometryCache();
+    RenderTexture2D target = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    unsigned char *scratch = malloc(SCREEN_WIDTH * SCREEN_HEIGHT * 3);
+
+    if (writeHeader && opt.y4m) WriteY4mHeader(out);
+
+    // Same start as pressing ENTER on the name screen
+    replayPlayback = true;
+    memcpy(tempName, replayHeader.name, sizeof(tempName));
+    letterCount = strlen(tempName);
+    StartRun(replayHeader.seed);
+
+    // Frames before the chunk are simulated but not drawn
+    for (int frame = 0; frame < end; frame++) {
+        ReplayFeedTick(frame);
+        UpdateGame();
+        simFrame++;
+
+        if (frame < opt.chunkStart) continue;
+
+        FrameSnapshot *snap = &snapshots[0];
+        CaptureSnapshot(snap);
+
+        BeginTextureMode(target);
+        DrawScene(snap);
+        EndTextureMode();
+
+        // Render textures come back bottom-up
+        Image img = LoadImageFromTexture(target.texture);
+        ImageFlipVertical(&img);
+        WriteFrame(out, img.data, opt.y4m, scratch);
+        UnloadImage(img);
+    }
+
+    free(scratch);
+    UnloadRenderTexture(target);
+    UnloadGeometryCache();
+    CloseWindow();
+
+    fflush(out);
+    if (opt.outPath) fclose(out);
+    return 0;
+}
+
+// Splits the run into contiguous frame ranges, renders them in child
+// processes concurrently, then streams the pieces out in order
+int RenderParallel(const char *exe, RenderOptions opt) {
+    int totalFrames = replayHeader.tickCount + REPLAY_TAIL_TICKS;
+    int jobs = opt.jobs > MAX_RENDER_JOBS ? MAX_RENDER_JOBS : opt.jobs;
+    int per = (totalFrames + jobs - 1) / jobs;
+
+    FILE *children[MAX_RENDER_JOBS];
+    char chunkPaths[MAX_RENDER_JOBS][512];
+
+    for (int i = 0; i < jobs; i++) {
+        snprintf(chunkPaths[i], sizeof(chunkPaths[i]), "%s.chunk%d", opt.replayPath, i);
+
+        // Frames go to the --out file; stdout is dropped so a chatty child
+        // can never block on a pipe nobody reads
+        char args[2048];
+        snprintf(args, sizeof(args), "\"%s\" --render \"%s\" --format %s --chunk %d:%d --out \"%s\" >" NULL_DEVICE,
+                 exe, opt.replayPath, opt.y4m ? "y4m" : "ppm", i * per, (i + 1) * per, chunkPaths[i]);
+
+        char cmd[2064];
+#ifdef _WIN32
+        // cmd /c strips the first and last quote of a line that starts with one
+        snprintf(cmd, sizeof(cmd), "\"%s\"", args);
+#else
+        snprintf(cmd, sizeof(cmd), "%s", args);
+#endif
+        children[i] = popen(cmd, "w");
+        if (!children[i]) {
+            fprintf(stderr, "Could not start render job %d\n", i);
+            return 1;
+        }
+    }
+
+    FILE *out = opt.outPath ? fopen(opt.outPath, "wb") : stdout;
+    if (!out) return 1;
+    if (opt.y4m) WriteY4mHeader(out);
+
+    int status = 0;
+    char buffer[1 << 16];
+    for (int i = 0; i < jobs; i++) {
+        if (pclose(children[i]) != 0) status = 1;
+
+        FILE *chunk = fopen(chunkPaths[i], "rb");
+        if (!chunk) {
+            status = 1;
+            continue;
+        }
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), chunk)) > 0) fwrite(buffer, 1, n, out);
+        fclose(chunk);
+        remove(chunkPaths[i]);
+    }
+
+    fflush(out);
+    if (opt.outPath) fclose(out);
+    return status;
+}
+
+int RunOfflineRender(const char *exe, RenderOptions opt) {
+#ifdef _WIN32
+    if (!opt.outPath) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (!ReplayLoad(opt.replayPath)) {
+        fprintf(stderr, "Could not load replay %s\n", opt.replayPath);
+        return 1;
+    }
+
+    SetupLevels();
+    ClearEntities();
+
+    // Children (--chunk) never write the Y4M header; the parent does
+    bool isChunk = opt.chunkEnd >= 0;
+    if (!isChunk && opt.jobs > 1) return RenderParallel(exe, opt);
+    return RenderFrames(opt, !isChunk);
+}
+
+// ==========================================
+//          BROADCAST
+// ==========================================
+// The host encodes each tick once on the simulation thread and hands the
+// packet to a broadcast thread, which queues the same buffer to every
+// spectator and drains the queues with non-blocking sends. A viewer that
+// falls too far behind is dropped back to waiting for the next keyframe.
+
+NetSocket broadcastListener = NET_INVALID;
+bool broadcasting = false;
+
+// Simulation side
+WireState wirePrevious;
+WireState wireCurrent;
+uint8_t wireScratch[WIRE_MAX_BYTES];
+bool forceKeyframe = true;
+
+// Simulation -> broadcast thread packet ring
+Packet *packetQueue[PACKET_QUEUE_SIZE];
+atomic_uint packetHead = 0;
+atomic_uint packetTail = 0;
+
+// Broadcast thread side
+Spectator spectators[MAX_SPECTATORS];
+int spectatorCount = 0;
+uint32_t lastBroadcastFrame = 0;
+
+int32_t Quantize(float v, float scale) {
+    return (int32_t)lrintf(v * scale);
+}
+
+void WirePush(WireSection *s, int32_t v) {
+    if (s->length < WIRE_SECTION_MAX) s->values[s->length++] = v;
+}
+
+void WirePushName(WireSection *s, const char name[16]) {
+    int32_t packed[4];
+    memcpy(packed, name, 16);
+    for (int i = 0; i < 4; i++) WirePush(s, packed[i]);
+}
+
+uint32_t PackColor(Color c) {
+    return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+}
+
+Color UnpackColor(uint32_t v) {
+    return (Color){ v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, v >> 24 };
+}
+
+void SnapshotToWire(const FrameSnapshot *s, WireState *w) {
+    for (int i = 0; i < WIRE_SECTION_COUNT; i++) w->sections[i].length = 0;
+
+    WireSection *core = &w->sections[WIRE_CORE];
+    WirePush(core, s->state);
+    WirePush(core, s->level);
+    WirePush(core, s->score);
+    WirePush(core, s->powerTicks);
+    WirePush(core, Quantize(s->pacmanY, WIRE_SCALE));
+    WirePush(core, Quantize(s->pacmanVelocityY, WIRE_ANGLE_SCALE));
+    WirePush(core, Quantize(s->mouthAngle, WIRE_ANGLE_SCALE));
+    WirePush(core, s->mouthFrame);
+    WirePush(core, s->runFrame);
+    WirePushName(core, s->name);
+
+    WireSection *pipeSec = &w->sections[WIRE_PIPES];
+    WirePush(pipeSec, s->pipeCount);
+    for (int i = 0; i < s->pipeCount; i++) {
+        WirePush(pipeSec, Quantize(s->pipeX[i], WIRE_SCALE));
+        WirePush(pipeSec, Quantize(s->pipeGapY[i], WIRE_SCALE));
+        WirePush(pipeSec, Quantize(s->orbRelY[i], WIRE_SCALE));
+    }
+    for (int word = 0; word * 32 < s->pipeCount; word++) {
+        uint32_t bits = 0;
+        for (int b = 0; b < 32 && word * 32 + b < s->pipeCount; b++) {
+            if (s->orbCollected[word * 32 + b]) bits |= 1u << b;
+        }
+        WirePush(pipeSec, (int32_t)bits);
+    }
+
+    WireSection *ghostSec = &w->sections[WIRE_GHOSTS];
+    WirePush(ghostSec, s->ghostCount);
+    for (int i = 0; i < s->ghostCount; i++) {
+        WirePush(ghostSec, Quantize(s->ghostX[i], WIRE_SCALE));
+        WirePush(ghostSec, Quantize(s->ghostY[i], WIRE_SCALE));
+        WirePush(ghostSec, (int32_t)PackColor(s->ghostColor[i]));
+    }
+
+    WireSection *pelletSec = &w->sections[WIRE_PELLETS];
+    WirePush(pelletSec, s->pelletCount);
+    for (int i = 0; i < s->pelletCount; i++) {
+        WirePush(pelletSec, Quantize(s->pelletX[i], WIRE_SCALE));
+        WirePush(pelletSec, Quantize(s->pelletY[i], WIRE_SCALE));
+    }
+
+    WireSection *board = &w->sections[WIRE_BOARD];
+    WirePush(board, s->playerCount);
+    WirePush(board, s->playerRank);
+    WirePush(board, s->playerBest);
+    WirePush(board, s->rankedPlayerCount);
+    WirePush(board, s->neighborCount);
+    for (int i = 0; i < s->playerCount; i++) {
+        WirePushName(board, s->players[i].name);
+        WirePush(board, s->players[i].score);
+    }
+    for (int i = 0; i < s->neighborCount; i++) {
+        WirePushName(board, s->neighbors[i].name);
+        WirePush(board, s->neighbors[i].score);
+        WirePush(board, s->neighborRanks[i]);
+    }
+}
+
+// Reads values back in the order SnapshotToWire() pushed them; anything
+// past the end of a section reads as 0, so a short packet can't overrun
+typedef struct {
+    const WireSection *section;
+    int cursor;
+} WireReader;
+
+int32_t WirePull(WireReader *r) {
+    return (r->cursor < r->section->length) ? r->section->values[r->cursor++] : 0;
+}
+
+int WirePullCount(WireReader *r, int max) {
+    int n = WirePull(r);
+    return (n < 0) ? 0 : (n > max ? max : n);
+}
+
+void WirePullName(WireReader *r, char name[16]) {
+    int32_t packed[4];
+    for (int i = 0; i < 4; i++) packed[i] = WirePull(r);
+    memcpy(name, packed, 16);
+    name[15] = '\0';
+}
+
+void WireToSnapshot(const WireState *w, uint32_t frame, FrameSnapshot *s) {
+    memset(s, 0, sizeof(*s));
+    s->frame = frame;
+
+    WireReader core = { &w->sections[WIRE_CORE], 0 };
+    s->state = WirePull(&core);
+    s->level = WirePull(&core);
+    if (s->state < STATE_INPUT || s->state > STATE_VICTORY) s->state = STATE_INPUT;
+    if (s->level < 0 || s->level >= MAX_LEVELS) s->level = 0;
+    s->score = WirePull(&core);
+    s->powerTicks = WirePull(&core);
+    s->pacmanY = WirePull(&core) / WIRE_SCALE;
+    s->pacmanVelocityY = WirePull(&core) / WIRE_ANGLE_SCALE;
+    s->mouthAngle = WirePull(&core) / WIRE_ANGLE_SCALE;
+    s->mouthFrame = WirePull(&core) & (MOUTH_FRAMES - 1);
+    s->runFrame = WirePull(&core);
+    WirePullName(&core, s->name);
+
+    WireReader pipeSec = { &w->sections[WIRE_PIPES], 0 };
+    s->pipeCount = WirePullCount(&pipeSec, MAX_PIPES);
+    for (int i = 0; i < s->pipeCount; i++) {
+        s->pipeX[i] = WirePull(&pipeSec) / WIRE_SCALE;
+        s->pipeGapY[i] = WirePull(&pipeSec) / WIRE_SCALE;
+        s->orbRelY[i] = WirePull(&pipeSec) / WIRE_SCALE;
+    }
+    for (int word = 0; word * 32 < s->pipeCount; word++) {
+        uint32_t bits = (uint32_t)WirePull(&pipeSec);
+        for (int b = 0; b < 32 && word * 32 + b < s->pipeCount; b++) {
+            s->orbCollected[word * 32 + b] = (bits >> b) & 1;
+        }
+    }
+
+    WireReader ghostSec = { &w->sections[WIRE_GHOSTS], 0 };
+    s->ghostCount = WirePullCount(&ghostSec, MAX_GHOSTS);
+    for (int i = 0; i < s->ghostCount; i++) {
+        s->ghostX[i] = WirePull(&ghostSec) / WIRE_SCALE;
+        s->ghostY[i] = WirePull(&ghostSec) / WIRE_SCALE;
+        s->ghostColor[i] = UnpackColor((uint32_t)WirePull(&ghostSec));
+    }
+
+    WireReader pelletSec = { &w->sections[WIRE_PELLETS], 0 };
+    s->pelletCount = WirePullCount(&pelletSec, MAX_PELLETS);
+    for (int i = 0; i < s->pelletCount; i++) {
+        s->pelletX[i] = WirePull(&pelletSec) / WIRE_SCALE;
+        s->pelletY[i] = WirePull(&pelletSec) / WIRE_SCALE;
+    }
+
+    WireReader board = { &w->sections[WIRE_BOARD], 0 };
+    s->playerCount = WirePullCount(&board, MAX_PLAYERS);
+    s->playerRank = WirePull(&board);
+    s->playerBest = WirePull(&board);
+    s->rankedPlayerCount = WirePull(&board);
+    s->neighborCount = WirePullCount(&board, NEIGHBOR_SPAN * 2 + 1);
+    for (int i = 0; i < s->playerCount; i++) {
+        WirePullName(&board, s->players[i].name);
+        s->players[i].score = WirePull(&board);
+    }
+    for (int i = 0; i < s->neighborCount; i++) {
+        WirePullName(&board, s->neighbors[i].name);
+        s->neighbors[i].score = WirePull(&board);
+        s->neighborRanks[i] = WirePull(&board);
+    }
+}
+
+void PutU32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24;
+}
+
+uint32_t GetU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Zig-zag varint, so small negative deltas stay one byte
+int PutVarint(uint8_t *p, int32_t value) {
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns bytes consumed, 0 on a truncated or oversized varint
+int GetVarint(const uint8_t *p, int available, int32_t *out) {
+    uint32_t v = 0;
+    for (int n = 0; n < available && n < 5; n++) {
+        v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *out = (int32_t)((v >> 1) ^ (0u - (v & 1)));
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// Packet layout: [u32 length of the rest][u8 type][u32 frame], then per
+// section a flag byte; flagged sections carry their length and one varint
+// delta per value. A keyframe is simply a delta against an empty state.
+int EncodeWire(const WireState *prev, const WireState *cur, bool keyframe, uint32_t frame, uint8_t *out) {
+    int n = 4;
+    out[n++] = keyframe ? PACKET_KEYFRAME : PACKET_DELTA;
+    PutU32(out + n, frame);
+    n += 4;
+
+    for (int i = 0; i < WIRE_SECTION_COUNT; i++) {
+        const WireSection *c = &cur->sections[i];
+        const WireSection *p = keyframe ? NULL : &prev->sections[i];
+
+        bool same = p && p->length == c->length &&
+                    memcmp(p->values, c->values, c->length * sizeof(int32_t)) == 0;
+        out[n++] = same ? 0 : 1;
+        if (same) continue;
+
+        n += PutVarint(out + n, c->length);
+        for (int v = 0; v < c->length; v++) {
+            int32_t base = (p && v < p->length) ? p->values[v] : 0;
+            n += PutVarint(out + n, (int32_t)((uint32_t)c->values[v] - (uint32_t)base));
+        }
+    }
+
+    PutU32(out, n - 4);
+    return n;
+}
+
+// Applies one packet body (after the length field) on top of 'state'
+bool DecodeWire(const uint8_t *body, int length, WireState *state, uint32_t *frame, bool *keyframe) {
+    if (length < 5) return false;
+    *keyframe = body[0] == PACKET_KEYFRAME;
+    *frame = GetU32(body + 1);
+    int n = 5;
+
+    for (int i = 0; i < WIRE_SECTION_COUNT; i++) {
+        WireSection *s = &state->sections[i];
+        if (*keyframe) s->length = 0;
+
+        if (n >= length) return false;
+        if (body[n++] == 0) continue;
+
+        int32_t count;
+        int used = GetVarint(body + n, length - n, &count);
+        if (used == 0 || count < 0 || count > WIRE_SECTION_MAX) return false;
+        n += used;
+
+        for (int v = 0; v < count; v++) {
+            int32_t delta;
+            used = GetVarint(body + n, length - n, &delta);
+            if (used == 0) return false;
+            n += used;
+
+            int32_t base = (v < s->length) ? s->values[v] : 0;
+            s->values[v] = (int32_t)((uint32_t)base + (uint32_t)delta);
+        }
+        s->length = count;
+    }
+    return true;
+}
+
+// Simulation thread, once per tick: encode once and hand it off
+void BroadcastTick(const FrameSnapshot *snap) {
+    if (!broadcasting) return;
+
+    SnapshotToWire(snap, &wireCurrent);
+
+    bool keyframe = forceKeyframe || simFrame % KEYFRAME_TICKS == 0;
+    int length = EncodeWire(&wirePrevious, &wireCurrent, keyframe, simFrame, wireScratch);
+    wirePrevious = wireCurrent;
+    forceKeyframe = false;
+
+    unsigned int head = atomic_load_explicit(&packetHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&packetTail, memory_order_acquire);
+    Packet *pkt = (head - tail < PACKET_QUEUE_SIZE) ? malloc(sizeof(Packet) + length) : NULL;
+    if (!pkt) {
+        // Broadcast thread is behind; the gap makes viewers resync
+        forceKeyframe = true;
+        return;
+    }
+
+    pkt->refs = 1;
+    pkt->keyframe = keyframe;
+    pkt->frame = simFrame;
+    pkt->length = length;
+    memcpy(pkt->bytes, wireScratch, length);
+
+    packetQueue[head & (PACKET_QUEUE_SIZE - 1)] = pkt;
+    atomic_store_explicit(&packetHead, head + 1, memory_order_release);
+}
+
+void ReleasePacket(Packet *pkt) {
+    if (--pkt->refs == 0) free(pkt);
+}
+
+// After both threads have stopped: frees what the simulation queued last
+void DrainPacketQueue() {
+    unsigned int tail = atomic_load(&packetTail);
+    unsigned int head = atomic_load(&packetHead);
+    for (; tail != head; tail++) ReleasePacket(packetQueue[tail & (PACKET_QUEUE_SIZE - 1)]);
+    atomic_store(&packetTail, tail);
+}
+
+void SpectatorReset(Spectator *v) {
+    for (int i = 0; i < v->queueCount; i++) {
+        ReleasePacket(v->queue[(v->queueHead + i) % SPECTATOR_BACKLOG]);
+    }
+    v->queueHead = 0;
+    v->queueCount = 0;
+    v->sentBytes = 0;
+    v->waitingForKeyframe = true;
+}
+
+// Drops everything queued except a packet that's partly on the wire, then
+// waits for the next keyframe
+void SpectatorResync(Spectator *v) {
+    int keep = (v->sentBytes > 0) ? 1 : 0;
+    for (int i = keep; i < v->queueCount; i++) {
+        ReleasePacket(v->queue[(v->queueHead + i) % SPECTATOR_BACKLOG]);
+    }
+    v->queueCount = keep;
+    v->waitingForKeyframe = true;
+}
+
+void FanOutPacket(Packet *pkt) {
+    // A missing frame means a delta was dropped upstream
+    bool gap = pkt->frame != lastBroadcastFrame + 1 && !pkt->keyframe;
+    lastBroadcastFrame = pkt->frame;
+
+    for (int i = 0; i < spectatorCount; i++) {
+        Spectator *v = &spectators[i];
+
+        if (gap) SpectatorResync(v);
+        if (v->waitingForKeyframe && !pkt->keyframe) continue;
+        if (v->queueCount == SPECTATOR_BACKLOG) {
+            SpectatorResync(v);
+            continue;
+        }
+
+        v->waitingForKeyframe = false;
+        v->queue[(v->queueHead + v->queueCount) % SPECTATOR_BACKLOG] = pkt;
+        v->queueCount++;
+        pkt->refs++;
+    }
+}
+
+// Returns false once the viewer has disconnected
+bool FlushSpectator(Spectator *v) {
+    while (v->queueCount > 0) {
+        Packet *pkt = v->queue[v->queueHead];
+        int n = NetSend(v->socket, pkt->bytes + v->sentBytes, pkt->length - v->sentBytes);
+        if (n < 0) return false;
+        if (n == 0) return true;
+
+        v->sentBytes += n;
+        if (v->sentBytes < pkt->length) return true;
+
+        ReleasePacket(pkt);
+        v->queueHead = (v->queueHead + 1) % SPECTATOR_BACKLOG;
+        v->queueCount--;
+        v->sentBytes = 0;
+    }
+    return true;
+}
+
+void *BroadcastThread(void *arg) {
+    (void)arg;
+
+    while (atomic_load(&simRunning)) {
+        bool idle = true;
+
+        NetSocket s;
+        while (spectatorCount < MAX_SPECTATORS && (s = NetAccept(broadcastListener)) != NET_INVALID) {
+            Spectator *v = &spectators[spectatorCount++];
+            memset(v, 0, sizeof(*v));
+            v->socket = s;
+            v->waitingForKeyframe = true;
+        }
+
+        unsigned int tail = atomic_load_explicit(&packetTail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&packetHead, memory_order_acquire);
+        while (tail != head) {
+            Packet *pkt = packetQueue[tail & (PACKET_QUEUE_SIZE - 1)];
+            FanOutPacket(pkt);
+            ReleasePacket(pkt);
+            tail++;
+            idle = false;
+        }
+        atomic_store_explicit(&packetTail, tail, memory_order_release);
+
+        for (int i = 0; i < spectatorCount; i++) {
+            if (!FlushSpectator(&spectators[i])) {
+                SpectatorReset(&spectators[i]);
+                NetClose(spectators[i].socket);
+                spectators[i] = spectators[--spectatorCount];
+                i--;
+            }
+        }
+
+        if (idle) SleepSeconds(0.001);
+    }
+
+    for (int i = 0; i < spectatorCount; i++) {
+        SpectatorReset(&spectators[i]);
+        NetClose(spectators[i].socket);
+    }
+    spectatorCount = 0;
+    return NULL;
+}
+
+// ------------------------------------------
+//  Spectator Client
+// ------------------------------------------
+
+int RunSpectator(const char *address) {
+    char host[256];
+    int port = BROADCAST_PORT;
+    snprintf(host, sizeof(host), "%s", address);
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    if (!NetInit()) return 1;
+    NetSocket s = NetConnect(host, port);
+    if (s == NET_INVALID) {
+        printf("Could not connect to %s:%d\n", host, port);
+        NetShutdown();
+        return 1;
+    }
+
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Flappy Pacman - Spectator");
+    BuildGeometryCache();
+    SetupLevels();
+    PacerInit(&pacer, FPS);
+
+    static WireState state;
+    static FrameSnapshot view;
+    static uint8_t pending[WIRE_MAX_BYTES * 2];
+    int pendingBytes = 0;
+    bool haveFrame = false;
+    bool connected = true;
+
+    while (!WindowShouldClose()) {
+        double frameStart = NowSeconds();
+        if (IsKeyPressed(KEY_F3)) showStats = !showStats;
+        if (IsKeyPressed(KEY_F4)) SetGeometryCache(!useGeometryCache);
+
+        // Pull whatever arrived and apply every complete packet
+        while (connected) {
+            int n = NetRecv(s, pending + pendingBytes, sizeof(pending) - pendingBytes);
+            if (n < 0) connected = false;
+            if (n <= 0) break;
+            pendingBytes += n;
+
+            int offset = 0;
+            while (pendingBytes - offset >= 4) {
+                uint32_t length = GetU32(pending + offset);
+                if (length > WIRE_MAX_BYTES) {
+                    connected = false;
+                    break;
+                }
+                if (pendingBytes - offset - 4 < (int)length) break;
+
+                uint32_t frame;
+                bool keyframe;
+                if (!DecodeWire(pending + offset + 4, length, &state, &frame, &keyframe)) {
+                    connected = false;
+                    break;
+                }
+                WireToSnapshot(&state, frame, &view);
+                haveFrame = true;
+                offset += 4 + length;
+            }
+            memmove(pending, pending + offset, pendingBytes - offset);
+            pendingBytes -= offset;
+        }
+
+        if (haveFrame) {
+            DrawGame(&view);
+        } else {
+            BeginDrawing();
+            ClearBackground(BLACK);
+            DrawText(connected ? "WAITING FOR HOST..." : "HOST DISCONNECTED", 260, 210, 20, WHITE);
+            EndDrawing();
+        }
+
+        double frameEnd = NowSeconds();
+        LoopStatsAdd(&renderStats, frameEnd, (frameEnd - frameStart) * 1000.0f, 1000.0f / FPS * 1.5f);
+        AdaptResolution((frameEnd - frameStart) * 1000.0f);
+        PacerWait(&pacer, frameEnd);
+    }
+
+    if (sceneTargetLoaded) UnloadRenderTexture(sceneTarget);
+    UnloadGeometryCache();
+    NetClose(s);
+    NetShutdown();
+    CloseWindow();
+    return 0;
+}
+
+// ==========================================
+//          SIMULATION THREAD
+// ==========================================
+
+// Fixed-rate ticks against an absolute schedule, so a slow tick is made up
+// by the next ones instead of drifting. Render stalls never block this loop.
+void *SimulationThread(void *arg) {
+    (void)arg;
+    double tickDuration = 1.0 / FPS;
+    double nextTick = NowSeconds();
+    simStats.windowStart = nextTick;
+
+    while (atomic_load(&simRunning)) {
+        double start = NowSeconds();
+
+        DrainInput();
+        UpdateGame();
+        ReplayRecordTick();
+        simFrame++;
+        const FrameSnapshot *published = PublishSnapshot();
+        BroadcastTick(published);
+
+        double end = NowSeconds();
+        LoopStatsAdd(&simStats, end, (end - start) * 1000.0f, tickDuration * 1000.0f);
+
+        nextTick += tickDuration;
+        if (end - nextTick > SIM_RESYNC_SECS) nextTick = end;
+        SleepSeconds(nextTick - NowSeconds());
+    }
+    return NULL;
+}
+
+// ==========================================
+//          MAIN
+// ==========================================
+
+int main(int argc, char **argv) {
+    // Usage: FlappyPacman --render run.pfr [--format ppm|y4m] [--jobs N] [--out file]
+    //        FlappyPacman --broadcast [PORT]    host, streaming to spectators
+    //        FlappyPacman --spectate HOST[:PORT]
+    RenderOptions render = { NULL, NULL, false, 1, 0, -1 };
+    const char *spectateAddress = NULL;
+    int broadcastPort = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) render.replayPath = argv[++i];
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) render.y4m = strcmp(argv[++i], "y4m") == 0;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) render.jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) render.outPath = argv[++i];
+        else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%d:%d", &render.chunkStart, &render.chunkEnd);
+        }
+        else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) spectateAddress = argv[++i];
+        else if (strcmp(argv[i], "--broadcast") == 0) {
+            broadcastPort = (i + 1 < argc && argv[i + 1][0] != '-') ? atoi(argv[++i]) : BROADCAST_PORT;
+        }
+    }
+    if (render.replayPath) return RunOfflineRender(argv[0], render);
+    if (spectateAddress) return RunSpectator(spectateAddress);
+
+    // Any window size works; the scene is scaled to fit
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Flappy Pacman - Scoreboard Edition");
+    BuildGeometryCache();
 
     SetupLevels();
+    ClearEntities();
 
     // Initialize empty players
     for(int i=0; i<MAX_PLAYERS; i++) players[i].active = false;
 
+    // Without an index the scoreboard only covers this session
+    if (!PlayerIndexOpen(INDEX_PATH)) {
+        printf("Could not open %s, scores will not be saved\n", INDEX_PATH);
+    }
+
+    // Spectators get their own thread so fan-out never slows a tick
+    pthread_t broadcastThread;
+    if (broadcastPort > 0 && NetInit()) {
+        broadcastListener = NetListen(broadcastPort);
+        if (broadcastListener != NET_INVALID) {
+            broadcasting = true;
+            pthread_create(&broadcastThread, NULL, BroadcastThread, NULL);
+        } else {
+            printf("Could not listen on port %d, broadcast disabled\n", broadcastPort);
+        }
+    }
+
+    // Simulation runs on its own thread; this one renders and polls input
+    PublishSnapshot();
+    pthread_t simThread;
+    pthread_create(&simThread, NULL, SimulationThread, NULL);
+
+    renderStats.windowStart = NowSeconds();
+    PacerInit(&pacer, FPS);
     while (!WindowShouldClose()) {
-        UpdateGame();
-        DrawGame();
+        double frameStart = NowSeconds();
+
+        CaptureInput();
+        if (IsKeyPressed(KEY_F3)) showStats = !showStats;
+        if (IsKeyPressed(KEY_F4)) SetGeometryCache(!useGeometryCache);
+
+        DrawGame(AcquireSnapshot());
+
+        double frameEnd = NowSeconds();
+        LoopStatsAdd(&renderStats, frameEnd, (frameEnd - frameStart) * 1000.0f, 1000.0f / FPS * 1.5f);
+        AdaptResolution((frameEnd - frameStart) * 1000.0f);
+        PacerWait(&pacer, frameEnd);
+    }
+
+    atomic_store(&simRunning, false);
+    pthread_join(simThread, NULL);
+
+    if (broadcasting) {
+        pthread_join(broadcastThread, NULL);
+        DrainPacketQueue();
+        NetClose(broadcastListener);
+        NetShutdown();
     }
 
+    if (sceneTargetLoaded) UnloadRenderTexture(sceneTarget);
+    UnloadGeometryCache();
+    PlayerIndexClose();
     CloseWindow();
     return 0;
 }
@@ -0,0 +1,125 @@
+#include "net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_FLAGS    0
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define closesocket   close
+#define WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#define SEND_FLAGS    MSG_NOSIGNAL
+#endif
+
+bool NetInit(void) {
+#ifdef _WIN32
+    WSADATA wsa;
+    return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+    return true;
+#endif
+}
+
+void NetShutdown(void) {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static void SetNonBlocking(NetSocket s) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket((SOCKET)s, FIONBIO, &on);
+#else
+    fcntl((int)s, F_SETFL, fcntl((int)s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Deltas are small and latency matters more than packing
+static void SetNoDelay(NetSocket s) {
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+}
+
+NetSocket NetListen(int port) {
+    NetSocket s = (NetSocket)socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NET_INVALID) return NET_INVALID;
+
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((unsigned short)port);
+
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, 128) != 0) {
+        closesocket(s);
+        return NET_INVALID;
+    }
+
+    SetNonBlocking(s);
+    return s;
+}
+
+NetSocket NetAccept(NetSocket listener) {
+    NetSocket s = (NetSocket)accept(listener, NULL, NULL);
+    if (s == NET_INVALID) return NET_INVALID;
+
+    SetNonBlocking(s);
+    SetNoDelay(s);
+    return s;
+}
+
+NetSocket NetConnect(const char *host, int port) {
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &result) != 0) return NET_INVALID;
+
+    NetSocket s = (NetSocket)socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (s != NET_INVALID && connect(s, result->ai_addr, (socklen_t)result->ai_addrlen) != 0) {
+        closesocket(s);
+        s = NET_INVALID;
+    }
+    freeaddrinfo(result);
+
+    if (s != NET_INVALID) {
+        SetNonBlocking(s);
+        SetNoDelay(s);
+    }
+    return s;
+}
+
+int NetSend(NetSocket s, const void *data, int length) {
+    int n = (int)send(s, (const char *)data, length, SEND_FLAGS);
+    if (n >= 0) return n;
+    return WOULD_BLOCK() ? 0 : -1;
+}
+
+int NetRecv(NetSocket s, void *data, int capacity) {
+    int n = (int)recv(s, (char *)data, capacity, 0);
+    if (n > 0) return n;
+    if (n == 0) return -1;
+    return WOULD_BLOCK() ? 0 : -1;
+}
+
+void NetClose(NetSocket s) {
+    if (s != NET_INVALID) closesocket(s);
+}
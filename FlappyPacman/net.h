@@ -0,0 +1,36 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ==========================================
+//          SOCKETS
+// ==========================================
+// Thin TCP wrapper kept out of main.c: winsock2.h and raylib.h declare
+// clashing names, so they can't share a translation unit on Windows.
+// All sockets handed out here are non-blocking except during NetConnect.
+
+typedef intptr_t NetSocket;
+
+#define NET_INVALID ((NetSocket)-1)
+
+bool NetInit(void);
+void NetShutdown(void);
+
+// Listens on every interface; returns NET_INVALID on failure
+NetSocket NetListen(int port);
+
+// Returns NET_INVALID when nobody is waiting
+NetSocket NetAccept(NetSocket listener);
+
+// Resolves 'host' and connects (blocking), then switches to non-blocking
+NetSocket NetConnect(const char *host, int port);
+
+// Bytes moved, 0 if the call would block, -1 once the peer is gone
+int NetSend(NetSocket s, const void *data, int length);
+int NetRecv(NetSocket s, void *data, int capacity);
+
+void NetClose(NetSocket s);
+
+#endif